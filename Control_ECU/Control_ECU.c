@@ -23,6 +23,22 @@
 #include "external_eeprom.h"
 #include "buzzer.h"
 #include "dc_motor.h"
+#include "encoder.h"
+#include "current_sense.h"
+#include "adc.h"
+#include "end_stop.h"
+#include "estop.h"
+#include "power.h"
+#include "work_queue.h"
+#include "sha256.h"
+#include "common_macros.h"
+#include <avr/io.h> /* To read the Timer1 count for the hash time */
+#include <util/atomic.h> /* To read the Timer1 tick and count together */
+
+#if (NUMBER_OF_DOORS > DC_MOTOR_NUM_CHANNELS) || (NUMBER_OF_DOORS > ENCODER_NUM_CHANNELS) \
+	|| (NUMBER_OF_DOORS > CURRENT_SENSE_NUM_CHANNELS) || (NUMBER_OF_DOORS > END_STOP_NUM_DOORS)
+#error "Every door needs its own motor, encoder, current sense and end-stop channels"
+#endif
 
 /*******************************************************************************
  *                           Global Variables                                  *
@@ -34,8 +50,15 @@ uint8 g_receivedPassword1[PASSWORD_SIZE];
 uint8 g_receivedPassword2[PASSWORD_SIZE];
 /* Global variable to represent the current state within the system sequence */
 uint8 g_CONTROL_SYSTEM_SEQUENCE = VERIFY_NEW_PASSWORD;
-/* Global variable for Timer1 interrupts counter */
-static uint8 g_tick = 0;
+/* Sequence of every door */
+static DoorContextType g_doors[NUMBER_OF_DOORS];
+/* Time measurements of the password hashes */
+static PasswordHashStatsType g_hashStats = { 0, 0, 0 };
+/*
+ * Salt entropy pool in the .noinit section, not cleared at reset: it holds the random power up content
+ * of the SRAM cells after a power cycle, and the digest of the last salt after a warm reset
+ */
+static uint8 g_saltPool[PASSWORD_SALT_POOL_SIZE] __attribute__((section(".noinit")));
 
 /*Global VIRTUAL EEPROM (Array) to check the logic before saving the passwords*/
 //uint8 EEPROM[PASSWORD_SIZE];
@@ -43,6 +66,175 @@ static uint8 g_tick = 0;
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
+/*
+ * Description :
+ * Private function to read the time in usec from the Timer1 tick and count, called with interrupts disabled.
+ * If the compare match flag is still pending the tick ISR did not count it yet, so count it here.
+ * It wraps with the 16-bit tick count, after 65536 ticks
+ * */
+static uint32 getTimeUs(void) {
+	uint16 count = TCNT1;
+	uint16 ticks = Timer1_getTicks();
+
+	if (BIT_IS_SET(TIFR, OCF1A) && (count < ((SYSTEM_TICK_COMPARE_VALUE + 1) / 2))) {
+		ticks++;
+	}
+	return ((uint32)ticks * (SYSTEM_TICK_COMPARE_VALUE + 1)) + count;
+}
+
+/*
+ * Description :
+ * Private function to hash a password with its salt: SHA-256(salt + password).
+ * The time of the hash is measured against PASSWORD_HASH_BUDGET_US
+ * */
+static void hashPassword(const uint8 salt[PASSWORD_SALT_SIZE], const uint8 password[PASSWORD_SIZE],
+		uint8 digest[SHA256_DIGEST_SIZE]) {
+	Sha256_ContextType context;
+	uint32 start;
+	uint32 end;
+	uint32 duration;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		start = getTimeUs();
+	}
+	Sha256_init(&context);
+	Sha256_update(&context, salt, PASSWORD_SALT_SIZE);
+	Sha256_update(&context, password, PASSWORD_SIZE);
+	Sha256_final(&context, digest);
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		end = getTimeUs();
+	}
+
+	if (end < start) {
+		/* The 16-bit tick count wrapped */
+		end += 65536UL * (SYSTEM_TICK_COMPARE_VALUE + 1);
+	}
+	duration = end - start;
+	if (duration > 0xFFFF) {
+		duration = 0xFFFF;
+	}
+	g_hashStats.last_us = (uint16)duration;
+	if (g_hashStats.last_us > g_hashStats.max_us) {
+		g_hashStats.max_us = g_hashStats.last_us;
+	}
+	if ((duration > PASSWORD_HASH_BUDGET_US) && (g_hashStats.budget_misses != 0xFF)) {
+		g_hashStats.budget_misses++;
+	}
+}
+
+/*
+ * Description :
+ * Private function to compare two byte arrays in a constant time: every byte is compared
+ * whatever the first difference is, so the time does not tell how much of a digest matched
+ * */
+static boolean isEqualConstantTime(const uint8 *a, const uint8 *b, uint8 size) {
+	uint8 difference = 0;
+	uint8 i;
+
+	for (i = 0; i < size; i++) {
+		difference |= a[i] ^ b[i];
+	}
+	return (difference == 0);
+}
+
+/*
+ * Description :
+ * Private function to wait at least the required time,
+ * the CPU runs the work items and the system ticks or sleeps meanwhile instead of a busy delay
+ * */
+static void waitMs(uint16 ms) {
+	uint16 start = Timer1_getTicks();
+
+	/* More than ms ticks are at least ms ms */
+	cli();
+	while ((uint16)(Timer1_getTicks() - start) <= ms) {
+		Power_enterIdle();
+		cli();
+	}
+	sei();
+}
+
+/*
+ * Description :
+ * Private function to write a byte into the EEPROM and wait its write cycle
+ * */
+static void eepromWriteByte(uint16 address, uint8 data) {
+	EEPROM_writeByte(address, data);
+	waitMs(EEPROM_WRITE_CYCLE_MS);
+}
+
+/*
+ * Description :
+ * Private function to make a new salt, unique but not secret: the SHA-256 digest of
+ * 1. the last salt, so every save in one power cycle gets a new salt.
+ * 2. the salt pool, the power up SRAM content: after a power cycle the last salt and the reset
+ *    relative time may repeat, the pool makes the salt differ. It is replaced by another part
+ *    of the digest, which is not in the salt.
+ * 3. the time the password is saved (usec since reset, it depends on the user timing).
+ * 4. ADC samples of the current sense inputs, their LSB noise is small while the motors are stopped.
+ * The SRAM power up content is not guaranteed random, so the uniqueness across power cycles
+ * is likely but not guaranteed, the salt is not a secret either way
+ * */
+static void makeSalt(uint8 salt[PASSWORD_SALT_SIZE]) {
+	Sha256_ContextType context;
+	uint8 digest[SHA256_DIGEST_SIZE];
+	uint8 data;
+	uint32 time;
+	uint16 sample;
+	uint8 i;
+
+	Sha256_init(&context);
+	for (i = 0; i < PASSWORD_SALT_SIZE; i++) {
+		EEPROM_readByte(EEPROM_SAVE_ADDRESS + 1 + i, &data);
+		Sha256_update(&context, &data, 1);
+	}
+	Sha256_update(&context, g_saltPool, PASSWORD_SALT_POOL_SIZE);
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		time = getTimeUs();
+	}
+	Sha256_update(&context, (const uint8 *)&time, sizeof(time));
+	for (i = 0; i < PASSWORD_SALT_ADC_SAMPLES; i++) {
+		/* The free running ADC has converted again after a tick */
+		waitMs(1);
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			sample = ADC_getResult();
+		}
+		Sha256_update(&context, (const uint8 *)&sample, sizeof(sample));
+	}
+	Sha256_final(&context, digest);
+	for (i = 0; i < PASSWORD_SALT_SIZE; i++) {
+		salt[i] = digest[i];
+	}
+	for (i = 0; i < PASSWORD_SALT_POOL_SIZE; i++) {
+		g_saltPool[i] = digest[SHA256_DIGEST_SIZE - PASSWORD_SALT_POOL_SIZE + i];
+	}
+}
+
+/*
+ * Description :
+ * Private function to check a password against the credential stored in EEPROM,
+ * it never matches if there is no valid credential
+ * */
+static boolean verifyPassword(const uint8 password[PASSWORD_SIZE]) {
+	uint8 salt[PASSWORD_SALT_SIZE];
+	uint8 storedDigest[SHA256_DIGEST_SIZE];
+	uint8 digest[SHA256_DIGEST_SIZE];
+	uint8 marker;
+	uint8 i;
+
+	EEPROM_readByte(EEPROM_SAVE_ADDRESS, &marker);
+	for (i = 0; i < PASSWORD_SALT_SIZE; i++) {
+		EEPROM_readByte(EEPROM_SAVE_ADDRESS + 1 + i, &salt[i]);
+	}
+	for (i = 0; i < SHA256_DIGEST_SIZE; i++) {
+		EEPROM_readByte(EEPROM_SAVE_ADDRESS + 1 + PASSWORD_SALT_SIZE + i, &storedDigest[i]);
+	}
+	/* The hash runs even without a valid credential, the time does not tell it */
+	hashPassword(salt, password, digest);
+	return isEqualConstantTime(digest, storedDigest, SHA256_DIGEST_SIZE)
+			&& (marker == EEPROM_PASSWORD_MARKER);
+}
+
 /*
  * Description :
  * Function to receive two passwords through UART
@@ -80,28 +272,48 @@ void confirmPassword(void) {
 }
 /*
  * Description :
- * Function to save a received password into EEPROM memory
- * The password is written to EEPROM memory at a specific address
- * Each element of the password array stored sequentially
+ * Function to save the credential of a received password into EEPROM memory:
+ * 1. Invalidate the stored credential, a reset in the middle of the save does not leave a mixed one.
+ * 2. Write a new salt and the digest of the salted password, then the valid marker.
+ * 3. Erase the raw password of the old layout if it is still there.
+ * The received passwords are cleared from RAM after that
  * */
 void savePassword(void) {
+	uint8 salt[PASSWORD_SALT_SIZE];
+	uint8 digest[SHA256_DIGEST_SIZE];
+	uint8 data;
 	uint8 i;
+
+	makeSalt(salt);
+	hashPassword(salt, g_receivedPassword1, digest);
+
+	eepromWriteByte(EEPROM_SAVE_ADDRESS, 0xFF);
+	for (i = 0; i < PASSWORD_SALT_SIZE; i++) {
+		eepromWriteByte(EEPROM_SAVE_ADDRESS + 1 + i, salt[i]);
+	}
+	for (i = 0; i < SHA256_DIGEST_SIZE; i++) {
+		eepromWriteByte(EEPROM_SAVE_ADDRESS + 1 + PASSWORD_SALT_SIZE + i, digest[i]);
+	}
+	/* The marker is written last, the credential is valid only after all of it is written */
+	eepromWriteByte(EEPROM_SAVE_ADDRESS, EEPROM_PASSWORD_MARKER);
+
 	for (i = 0; i < PASSWORD_SIZE; i++) {
-		//EEPROM[i] = g_receivedPassword1[i];
-		EEPROM_writeByte(EEPROM_SAVE_ADDRESS + i, g_receivedPassword1[i]);
-		_delay_ms(10);
+		EEPROM_readByte(EEPROM_LEGACY_PASSWORD_ADDRESS + i, &data);
+		if (data != 0xFF) {
+			eepromWriteByte(EEPROM_LEGACY_PASSWORD_ADDRESS + i, 0xFF);
+		}
+		g_receivedPassword1[i] = 0;
+		g_receivedPassword2[i] = 0;
 	}
 }
 /*
  * Description :
- * Function to receive a password from another ECU using UART and
- * read the stored password from EEPROM in the Control ECU.
+ * Function to receive a password from another ECU using UART.
  *
  * Parameters:
  * - receivedPassword: Array to store the received password.
- * - storedPassword: Array to store the password read from EEPROM.
  */
-void receive_read_Password(uint8 receivedPassword[PASSWORD_SIZE], uint8 storedPassword[PASSWORD_SIZE])
+void receivePassword(uint8 receivedPassword[PASSWORD_SIZE])
 {
     uint8 i;
 
@@ -110,34 +322,23 @@ void receive_read_Password(uint8 receivedPassword[PASSWORD_SIZE], uint8 storedPa
     for (i = 0; i < PASSWORD_SIZE; i++) {
         receivedPassword[i] = UART_receiveByte();
     }
-
-    for (i = 0; i < PASSWORD_SIZE; i++) {
-        EEPROM_readByte(EEPROM_SAVE_ADDRESS + i, &storedPassword[i]);
-    }
 }
 /*
  * Description :
- * - Function to compare between the input password at HMI ECU
- * and the stored password at EEPROM in Control ECU
+ * - Function to check the input password at HMI ECU
+ * against the credential stored at EEPROM in Control ECU
  * - Call the alarm if the two passwords are not matched
  * for a number of consecutive times
  * */
 void checkPassword(void) {
 	uint8 i;
     uint8 receivedPassword[PASSWORD_SIZE];
-    uint8 storedPassword[PASSWORD_SIZE];
     uint8 failuresCounter = 0;
-    receive_read_Password(receivedPassword, storedPassword);
+    receivePassword(receivedPassword);
 
 	/*Loop to check the number of failures during user inputs the password*/
 	while (failuresCounter < NUMBER_OF_CONSECUTIVE_FAILURES) {
-		boolean isFailure = 0; /* Assume no failure initially */
-		for (i = 0; i < PASSWORD_SIZE; i++) {
-			if (receivedPassword[i] != storedPassword[i]) {
-				isFailure = 1;
-				break; /* Break out of the loop when a failure occurs*/
-			}
-		}
+		boolean isFailure = !verifyPassword(receivedPassword);
 		if (isFailure) {
 			failuresCounter++;
 		    if(failuresCounter == NUMBER_OF_CONSECUTIVE_FAILURES)
@@ -146,87 +347,437 @@ void checkPassword(void) {
 		    }
 			g_passwordFlag = PASSWORDS_UNMATCHED;
 			UART_sendByte(g_passwordFlag);
+			Buzzer_play(BUZZER_FAILURE);
 
 			/* fetch new password from HMI ECU*/
-		    receive_read_Password(receivedPassword, storedPassword);
+		    receivePassword(receivedPassword);
 		} else {
 			failuresCounter = 0; /* Reset consecutive failures count on success*/
 			g_passwordFlag = PASSWORDS_MATCHED;
 			break;
 		}
 	}
+	/* The received password is not kept in RAM */
+	for (i = 0; i < PASSWORD_SIZE; i++) {
+		receivedPassword[i] = 0;
+	}
 	if (failuresCounter < NUMBER_OF_CONSECUTIVE_FAILURES) {
 		UART_sendByte(g_passwordFlag);
+		Buzzer_play(BUZZER_SUCCESS);
 	}
 	else {
 		g_passwordFlag = PASSWORDS_UNMATCHED;
 		UART_sendByte(g_passwordFlag);
-		/* ACTIVATE BUZZER (ALARM) FOR 1 MINUTE */
-
-		/* Timer1 Configuration
-		 * ---------------------
-		 * F_Timer = 8MHz/1024(from Pre-scaler) = 7812 Hz
-		 * T_Timer = 1/7812 = 128usec
-		 * T_Compare = Compare Value * 128usec
-		 * As I need 8 interrupts ( 8 compare matches ) per 60 second, so T_Compare = 60/8
-		 * 60/8 = Compare Value * 128usec
-		 * Compare Value = 7.5/128usec = 58594
-		 * Compare Value = 58594
-		 */
-		Timer1_ConfigType TimerConfiguration = { 0, 58594, PRESCALER_1024,
-				CTC_MODE };
-		Timer1_init(&TimerConfiguration);
-		Buzzer_on();
-		Timer1_setCallBack(activateAlarm);
+		/* ACTIVATE BUZZER (ALARM) FOR 1 MINUTE, played by the buzzer Timer2 ISR */
+		startAlarm();
 	}
 }
 
 /*
  * Description :
- * Callback Function to activate an alarm using Timer1 and Buzzer with for 1 Minute
+ * Function to play the escalating alarm pattern for 1 Minute, it returns at once
  * */
-void activateAlarm(void) {
-	g_tick++;
-	if (g_tick == 8) {
-		Buzzer_off();
-		g_tick = 0; /* Reset the interrupts counter */
-		Timer1_deInit(); /* Reset timer1 registers */
+void startAlarm(void) {
+	Buzzer_play(BUZZER_ALARM);
+}
+
+/*
+ * Description :
+ * Function to get the time measurements of the password hashes
+ * */
+void getPasswordHashStats(PasswordHashStatsType *stats) {
+	*stats = g_hashStats;
+}
+
+/*
+ * Description :
+ * Private function to start a door move, the timeout is based on the learned travel time
+ * of the move if it is known
+ * */
+static void doorStartMove(uint8 door, DoorMoveType move) {
+	DoorContextType *context = &g_doors[door];
+	uint16 learned = context->travel_times[move];
+	uint32 timeout;
+
+	context->move = move;
+	if (move == DOOR_MOVE_UNLOCK) {
+		context->target = DOOR_UNLOCKED_POSITION;
+	} else {
+		context->target = DOOR_LOCKED_POSITION;
+	}
+	context->timeout = DOOR_TRAVEL_TIMEOUT_MS;
+	if (learned != 0) {
+		timeout = learned + ((uint32)learned * DOOR_TRAVEL_MARGIN_PERCENT / 100) + DOOR_TRAVEL_MARGIN_MS;
+		if (timeout < DOOR_TRAVEL_TIMEOUT_MS) {
+			context->timeout = (uint16)timeout;
+		}
 	}
+	context->time = 0;
+	context->attempt_time = 0;
+	context->retries = 0;
+	context->retry_pending = FALSE;
+	context->interrupted = FALSE;
+	DcMotor_moveTo(door, context->target);
 }
+
 /*
  * Description :
- * Callback function for timer1, controlling the door using DC-Motor
+ * Private function to update the running average of the travel time with the move that just ended,
+ * only a move without stall retries or emergency stops is a measure of the door travel
  * */
-void doorControl(void) {
+static void doorLearnTravelTime(DoorContextType *context) {
+#if (DOOR_LEARNING_ENABLE == TRUE)
+	uint16 *average = &context->travel_times[context->move];
+
+	if ((context->retries != 0) || context->interrupted) {
+		return;
+	}
+	if (*average == 0) {
+		*average = context->time;
+	} else {
+		*average += ((sint16)(context->time - *average)) / (1 << DOOR_LEARNING_AVERAGE_SHIFT);
+	}
+	context->travel_times_changed = TRUE;
+#else
+	(void)context;
+#endif
+}
 
-	g_tick++;
-	/* TWO Interrupts for 15 Second*/
-	if (g_tick == 2) {
-		Timer1_deInit(); /* Reset timer1 registers */
+/*
+ * Description :
+ * Private function called every new system tick during a door move with the ms elapsed since the last call,
+ * returns DONE or FAILED when the move ended:
+ * 1. The motor reached the target position, or the end-stop switch of the target closed
+ *    (the encoder is re-aligned to the target), the travel time is learned: DONE.
+ * 2. The motor stalled (after the start current blanking time):
+ *    - close to the target it is the end stop, the encoder is re-aligned to it: DONE.
+ *    - else the motor is cut off and the move retried after DOOR_RETRY_DELAY_MS,
+ *      after DOOR_STALL_RETRIES retries the move is abandoned and the alarm is raised: FAILED.
+ * 3. The move is longer than its learned timeout: it goes on with the worst case timeout
+ *    DOOR_TRAVEL_TIMEOUT_MS, and its time is learned if it ends at its position.
+ *    A move longer than DOOR_TRAVEL_TIMEOUT_MS is cut off: FAILED.
+ * */
+static DoorMoveResultType doorMoveTask(uint8 door, uint16 elapsed) {
+	DoorContextType *context = &g_doors[door];
+	sint32 remaining;
+	EndStop_IdType endStop;
 
-		/* For holding the door 3 seconds, we need to re-configure Timer1
-		 * Compare Value = 23438 */
-		Timer1_ConfigType TimerConfiguration2 = { 0, 23438, PRESCALER_1024,
-				CTC_MODE };
-		Timer1_init(&TimerConfiguration2);
-		DcMotor_Rotate(STOP, 0);
+	context->time += elapsed;
+	context->attempt_time += elapsed;
+	if (context->time >= context->timeout) {
+		if (context->timeout < DOOR_TRAVEL_TIMEOUT_MS) {
+			/* The door is slower than it learned (e.g. a stiff bolt or a low supply) */
+			context->timeout = DOOR_TRAVEL_TIMEOUT_MS;
+		} else {
+			DcMotor_cutOff(door);
+			return DOOR_RESULT_FAILED;
+		}
+	}
+	if (context->retry_pending) {
+		if (context->attempt_time >= DOOR_RETRY_DELAY_MS) {
+			context->retry_pending = FALSE;
+			context->attempt_time = 0;
+			DcMotor_moveTo(door, context->target);
+		}
+		return DOOR_RESULT_RUNNING;
 	}
-	/* One Interrupt for 3 Seconds with the new configuration*/
-	if (g_tick == 3) {
+	if (DcMotor_isMoveDone(door)) {
+		doorLearnTravelTime(context);
+		return DOOR_RESULT_DONE;
+	}
+	if (context->move == DOOR_MOVE_UNLOCK) {
+		endStop = END_STOP_UNLOCKED;
+	} else {
+		endStop = END_STOP_LOCKED;
+	}
+	if (EndStop_isActive(door, endStop)) {
+		DcMotor_cutOff(door);
+		Encoder_setPosition(door, context->target);
+		doorLearnTravelTime(context);
+		return DOOR_RESULT_DONE;
+	}
+	if ((context->attempt_time < DOOR_STALL_BLANKING_MS) || !CurrentSense_isStalled(door)) {
+		return DOOR_RESULT_RUNNING;
+	}
+
+	DcMotor_cutOff(door);
+	remaining = context->target - Encoder_getPosition(door);
+	if ((remaining <= DOOR_END_OF_TRAVEL_COUNTS) && (remaining >= -DOOR_END_OF_TRAVEL_COUNTS)) {
+		Encoder_setPosition(door, context->target);
+		doorLearnTravelTime(context);
+		return DOOR_RESULT_DONE;
+	}
+	if (context->retries < DOOR_STALL_RETRIES) {
+		context->retries++;
+		context->retry_pending = TRUE;
+		context->attempt_time = 0;
+		return DOOR_RESULT_RUNNING;
+	}
+	startAlarm();
+	return DOOR_RESULT_FAILED;
+}
+
+/*
+ * Description :
+ * Private function to return TRUE if the learned travel times of a door changed since they were saved
+ * */
+static boolean doorTravelTimesChanged(void) {
+	uint8 door;
+
+	for (door = 0; door < NUMBER_OF_DOORS; door++) {
+		if (g_doors[door].travel_times_changed) {
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*
+ * Description :
+ * Function to read the learned travel times of every door from EEPROM memory,
+ * they stay unknown (zero) if the EEPROM has no valid travel times for the door
+ * */
+void loadTravelTimes(void) {
+	uint16 address;
+	uint8 marker;
+	uint8 low;
+	uint8 high;
+	uint8 door;
+	uint8 i;
+
+	for (door = 0; door < NUMBER_OF_DOORS; door++) {
+		address = EEPROM_TRAVEL_TIMES_ADDRESS + (door * EEPROM_TRAVEL_TIMES_BLOCK_SIZE);
+		EEPROM_readByte(address, &marker);
+		if (marker != EEPROM_TRAVEL_TIMES_MARKER) {
+			continue;
+		}
+		for (i = 0; i < DOOR_NUM_MOVES; i++) {
+			EEPROM_readByte(address + 1 + (2 * i), &low);
+			EEPROM_readByte(address + 2 + (2 * i), &high);
+			g_doors[door].travel_times[i] = ((uint16)high << 8) | low;
+		}
+	}
+}
+
+/*
+ * Description :
+ * Function to save the learned travel times of every door into EEPROM memory if they changed,
+ * the times are copied first: a time learned by the system ticks that run during the EEPROM write cycles
+ * sets the changed flag again and is saved next time
+ * */
+void saveTravelTimes(void) {
+	uint16 times[DOOR_NUM_MOVES];
+	uint16 address;
+	boolean changed;
+	uint8 door;
+	uint8 i;
+
+	for (door = 0; door < NUMBER_OF_DOORS; door++) {
+		changed = g_doors[door].travel_times_changed;
+		g_doors[door].travel_times_changed = FALSE;
+		for (i = 0; i < DOOR_NUM_MOVES; i++) {
+			times[i] = g_doors[door].travel_times[i];
+		}
+		if (!changed) {
+			continue;
+		}
+		address = EEPROM_TRAVEL_TIMES_ADDRESS + (door * EEPROM_TRAVEL_TIMES_BLOCK_SIZE);
+		for (i = 0; i < DOOR_NUM_MOVES; i++) {
+			eepromWriteByte(address + 1 + (2 * i), (uint8)times[i]);
+			eepromWriteByte(address + 2 + (2 * i), (uint8)(times[i] >> 8));
+		}
+		/* The marker is written last, the times are valid only after all of them are written */
+		eepromWriteByte(address, EEPROM_TRAVEL_TIMES_MARKER);
+	}
+}
+
+/*
+ * Description :
+ * Callback function for timer1 to run the system tick (1 ms) tasks in the main context,
+ * called once for every tick counted by the Timer1 ISR: the power statistics, encoder,
+ * end-stop and door tasks. Ticks counted while the main context was busy are run back to back
+ * with the same Timer1 tick count: only the first of them runs the tasks, the doors are given
+ * the real time elapsed since the last run, so a burst is neither counted as many readings
+ * nor loses time when the pending ticks saturate
+ * */
+void controlTick(void) {
+	static uint16 lastTick = 0;
+	uint16 tick = Timer1_getTicks();
+	uint16 elapsed = tick - lastTick;
+
+	if (elapsed == 0) {
+		return;
+	}
+	lastTick = tick;
+	Power_tickTask();
+	Encoder_tickTask();
+	EndStop_tickTask();
+	doorControl(elapsed);
+}
+
+/*
+ * Description :
+ * Private function run by Power_enterIdle instead of sleeping while there is work:
+ * the work items posted by the ISRs first, so an emergency stop is handled before the door ticks,
+ * then the pending system ticks.
+ * Called with the interrupts disabled, it returns FALSE with them still disabled if there is no work
+ * */
+static boolean controlIdleTask(void) {
+	if (WorkQueue_runPending()) {
+		return TRUE;
+	}
+	return Timer1_runPendingTicks();
+}
+
+/*
+ * Description :
+ * Private function to run the pending work items and system ticks from the main loop,
+ * between the steps that do not wait in Power_enterIdle (password hashes, UART frames already received)
+ * */
+static void controlRunPending(void) {
+	cli();
+	while (controlIdleTask()) {
+		cli();
+	}
+	sei();
+}
+
+/*
+ * Description :
+ * Private work item posted by the obstruction and emergency stop ISRs, all the motors are already
+ * braked by the ISR and it runs in the main context as soon as the running work ends:
+ * - bring the motor driver of every door to the braked state.
+ * - an obstruction while locking reverses, the door is unlocked again then held and locked as usual.
+ * - the sequences are held while an input is active (the move time does not count),
+ *   a braked move starts again when the inputs are released.
+ * */
+static void doorEStopTask(uint8 arg) {
+	EStop_EventType event = EStop_getEvent();
+	DoorContextType *context;
+	uint8 door;
+
+	(void)arg;
+	if (event == ESTOP_NONE) {
+		return;
+	}
+	for (door = 0; door < NUMBER_OF_DOORS; door++) {
+		context = &g_doors[door];
+		DcMotor_brake(door);
+		if ((event == ESTOP_OBSTRUCTION) && (context->state == DOOR_LOCKING)) {
+			doorStartMove(door, DOOR_MOVE_UNLOCK);
+			context->state = DOOR_UNLOCKING;
+		}
+		context->interrupted = TRUE;
+		context->held = TRUE;
+	}
+}
 
-		Timer1_deInit(); /* Reset timer1 registers */
+/*
+ * Description :
+ * Private function called every new system tick for every door with the ms elapsed since the last call,
+ * controlling the door using its DC-Motor:
+ * 1. UNLOCKING/LOCKING: wait until the door move ended. At its position (or end stop) tell the
+ *    HMI ECU that the door is unlocked or locked. A failed move (abandoned after stalls or worst case
+ *    timeout) sends the door fault instead and the door goes idle, the next open request moves it again.
+ * 2. HOLDING: keep the door unlocked for DOOR_HOLDING_TIME_MS then start locking.
+ * It runs in the main context from the system tick callback, so the event is sent without
+ * delaying the ISRs.
+ * After an obstruction or emergency stop (doorEStopTask) the sequence is held while an input
+ * is active, then a braked move starts again.
+ * */
+static void doorSequence(uint8 door, uint16 elapsed) {
+	DoorContextType *context = &g_doors[door];
+	DoorMoveResultType result;
 
-		/*We need to reconfigure timer1 to wait 15 seconds door locking time*/
-		Timer1_ConfigType TimerConfiguration3 = { 0, 58594, PRESCALER_1024,
-				CTC_MODE };
-		Timer1_init(&TimerConfiguration3);
-		DcMotor_Rotate(ACW, 100);
+	if (context->held) {
+		if (EStop_isInputActive()) {
+			return;
+		}
+		context->held = FALSE;
+		if ((context->state == DOOR_UNLOCKING) || (context->state == DOOR_LOCKING)) {
+			context->attempt_time = 0;
+			context->retry_pending = FALSE;
+			DcMotor_moveTo(door, context->target);
+		}
 	}
-/* TWO Interrupts for 15 Second with the previous configuration*/
-	if (g_tick == 5) {
-		g_tick = 0; /* Reset the interrupts counter */
-		Timer1_deInit(); /* Reset timer1 registers */
-		DcMotor_Rotate(STOP, 0);
+
+	switch (context->state) {
+	case DOOR_IDLE:
+		break;
+	case DOOR_UNLOCKING:
+	case DOOR_LOCKING:
+		result = doorMoveTask(door, elapsed);
+		if (result == DOOR_RESULT_RUNNING) {
+			break;
+		}
+		context->time = 0;
+		if (result == DOOR_RESULT_FAILED) {
+			UART_sendByte(DOOR_FAULT + door);
+			context->state = DOOR_IDLE;
+		} else if (context->state == DOOR_UNLOCKING) {
+			UART_sendByte(DOOR_UNLOCKED + door);
+			context->state = DOOR_HOLDING;
+		} else {
+			UART_sendByte(DOOR_LOCKED + door);
+			context->state = DOOR_IDLE;
+		}
+		break;
+	case DOOR_HOLDING:
+		context->time += elapsed;
+		if (context->time >= DOOR_HOLDING_TIME_MS) {
+			doorStartMove(door, DOOR_MOVE_LOCK);
+			context->state = DOOR_LOCKING;
+		}
+		break;
+	}
+}
+
+/*
+ * Description :
+ * Function called for every new system tick by the tick callback with the ms elapsed since its last call,
+ * it runs the sequence of every door
+ * */
+void doorControl(uint16 elapsed) {
+	uint8 door;
+
+	for (door = 0; door < NUMBER_OF_DOORS; door++) {
+		doorSequence(door, elapsed);
+	}
+}
+
+/*
+ * Description :
+ * Function to start the sequence of the required door, the door sequences run in the main context too
+ * so the door context can be changed without disabling the interrupts:
+ * - IDLE: unlock the door.
+ * - UNLOCKING: nothing to do, the HMI ECU is told when the door is unlocked.
+ * - HOLDING: the holding time starts again and the HMI ECU is told the door is unlocked.
+ * - LOCKING: the door is unlocked again like after an obstruction.
+ * */
+void openDoor(uint8 door) {
+	DoorContextType *context;
+
+	if (door >= NUMBER_OF_DOORS) {
+		return;
+	}
+	context = &g_doors[door];
+	switch (context->state) {
+	case DOOR_IDLE:
+		doorStartMove(door, DOOR_MOVE_UNLOCK);
+		context->state = DOOR_UNLOCKING;
+		break;
+	case DOOR_LOCKING:
+		/* A move from the middle is not a travel measure */
+		doorStartMove(door, DOOR_MOVE_UNLOCK);
+		context->interrupted = TRUE;
+		context->state = DOOR_UNLOCKING;
+		break;
+	case DOOR_UNLOCKING:
+		break;
+	case DOOR_HOLDING:
+		context->time = 0;
+		UART_sendByte(DOOR_UNLOCKED + door);
+		break;
 	}
 }
 
@@ -235,8 +786,15 @@ void doorControl(void) {
  *******************************************************************************/
 
 int main(void) {
+	uint8 door;
 	/* Enable Global Interrupts */
 	SREG |= (1 << 7);
+
+	/* Power Management Initialization, the CPU sleeps whenever it waits for the HMI ECU
+	 * and runs the work posted by the ISRs and the system ticks counted by the Timer1 ISR
+	 * instead while there are some */
+	Power_init();
+	Power_setIdleTask(controlIdleTask);
 	/* UART Configuration */
 	UART_ConfigType UART_Configuration = { EIGHT_BITS_DATA, DISABLED,
 			ONE_STOP_BIT, BAUD_RATE_9600_BPS };
@@ -251,10 +809,44 @@ int main(void) {
 	/* Dc-Motor Initialization */
 	DcMotor_init();
 
-	/* Buzzer Initialization */
+	/* Obstruction and Emergency Stop Initialization, their ISRs brake the motor
+	 * and post doorEStopTask to the work queue */
+	EStop_setCallBack(doorEStopTask);
+	EStop_init();
+
+	/* Buzzer Initialization, the tone patterns are played by Timer2 */
 	Buzzer_init();
 
+	/* Timer1 Configuration
+	 * ---------------------
+	 * F_Timer = 8MHz/8(from Pre-scaler) = 1 MHz
+	 * T_Timer = 1/1MHz = 1usec, the encoder period resolution
+	 * T_Compare = (Compare Value + 1) * 1usec
+	 * As I need one interrupt per 1 msec (the system tick)
+	 * Compare Value = (1msec/1usec) - 1 = 999
+	 * The ISR only counts the ticks, controlTick runs from the idle waits
+	 */
+	Timer1_ConfigType TimerConfiguration = { 0, SYSTEM_TICK_COMPARE_VALUE,
+			PRESCALER_8, CTC_MODE };
+	Timer1_setCallBack(controlTick);
+	Timer1_init(&TimerConfiguration);
+
+	/* Encoders Initialization, the doors are locked at reset */
+	Encoder_init();
+	for (door = 0; door < NUMBER_OF_DOORS; door++) {
+		Encoder_setPosition(door, DOOR_LOCKED_POSITION);
+	}
+
+	/* Motor Current Sensing Initialization, ADC free running from its interrupt */
+	CurrentSense_init();
+
+	/* End-Stop Switches Initialization and the learned door travel times */
+	EndStop_init();
+	loadTravelTimes();
+
 	while (1) {
+		/* The door sequences also run here, not only while the main loop waits in Power_enterIdle */
+		controlRunPending();
 		switch (g_CONTROL_SYSTEM_SEQUENCE) {
 		case VERIFY_NEW_PASSWORD:
 			/* Verify a new password by receiving it from the HMI ECU through UART.
@@ -262,8 +854,9 @@ int main(void) {
 			 * if not, the Control ECU keeps receiving new passwords*/
 			while (g_passwordFlag != PASSWORDS_MATCHED) {
 				receiveTwoPasswords();
-				_delay_ms(15);
+				waitMs(15);
 				confirmPassword();
+				controlRunPending();
 			}
 			if (g_passwordFlag == PASSWORDS_MATCHED) {
 				savePassword();
@@ -272,7 +865,20 @@ int main(void) {
 			g_passwordFlag = PASSWORDS_UNMATCHED; /*resets the flag*/
 			break;
 		case MAIN_OPTIONS:
+			/* Sleep until the HMI ECU choice, the running door sequences do not wait for it:
+			 * the system tick runs from the idle waits. Meanwhile keep what the door moves learned */
+			cli();
+			while (!UART_isByteReceived() && !doorTravelTimesChanged()) {
+				Power_enterIdle();
+				cli();
+			}
+			sei();
+			saveTravelTimes();
+			if (!UART_isByteReceived()) {
+				break;
+			}
 			/*To know the next step for Control ECU we use the HMI_SYSTEM_SEQUENCE*/
+			Buzzer_play(BUZZER_KEY_CLICK);
 			if (UART_receiveByte() == OPEN_DOOR) {
 				g_CONTROL_SYSTEM_SEQUENCE = OPEN_DOOR;
 			} else {
@@ -280,26 +886,17 @@ int main(void) {
 			}
 			break;
 		case OPEN_DOOR:
+			/* The door number comes before the password */
+			door = UART_receiveByte();
+			Buzzer_play(BUZZER_KEY_CLICK);
 			checkPassword();
 			if (g_passwordFlag == PASSWORDS_MATCHED) {
-
-				/* Timer1 Configuration
-				 * ---------------------
-				 * F_Timer = 8MHz/1024(from Pre-scaler) = 7812 Hz
-				 * T_Timer = 1/7812 = 128usec
-				 * T_Compare = Compare Value * 128usec
-				 * As I need two interrupts ( two compare matches ) per 15 second, so T_Compare = 15
-				 * 15/2 = Compare Value * 128usec
-				 * Compare Value = 7.5/128usec = 58594
-				 * Compare Value = 58594
-				 */
-				Timer1_ConfigType TimerConfiguration1 = { 0, 58594,
-						PRESCALER_1024, CTC_MODE };
-				Timer1_init(&TimerConfiguration1);
-				DcMotor_Rotate(cw, 100);
-				Timer1_setCallBack(doorControl);
+				/* The system tick runs the door sequence, it stops on the encoder position */
+				openDoor(door);
 			}
 			g_passwordFlag = PASSWORDS_UNMATCHED; /*reset the flag*/
+			/* Back to the main options like the HMI ECU */
+			g_CONTROL_SYSTEM_SEQUENCE = MAIN_OPTIONS;
 			break;
 		case CHANGE_PASSWORD:
 			checkPassword();
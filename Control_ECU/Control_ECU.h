@@ -19,17 +19,118 @@
 #define PASSWORD_SIZE 			          5
 #define PASSWORDS_UNMATCHED		          0
 #define PASSWORDS_MATCHED			      1
-#define EEPROM_SAVE_ADDRESS 			  0x0400 /* Saving address in EEPROM for storing data */
+/*
+ * Saving address in EEPROM of the password credential: valid marker, random salt,
+ * then the SHA-256 digest of the salt followed by the password. The password itself is never saved,
+ * the raw password of the old layout (at EEPROM_LEGACY_PASSWORD_ADDRESS) is erased by the next save.
+ */
+#define EEPROM_SAVE_ADDRESS 			  0x0440
+#define EEPROM_PASSWORD_MARKER            0x5A
+#define EEPROM_LEGACY_PASSWORD_ADDRESS    0x0400
+#define PASSWORD_SALT_SIZE                8
+/*
+ * Entropy of a new salt besides the previous salt and the save time: the power up content of an SRAM
+ * pool that the C startup does not clear, and the LSB noise of ADC samples taken 1 ms or more apart
+ */
+#define PASSWORD_SALT_POOL_SIZE           16
+#define PASSWORD_SALT_ADC_SAMPLES         8
+/* Worst password hash time accepted for the verification latency, one SHA-256 compression */
+#define PASSWORD_HASH_BUDGET_US           20000
+/* EEPROM write cycle, the system ticks run meanwhile */
+#define EEPROM_WRITE_CYCLE_MS             10
 #define FIRST_TRIAL						  1
 #define SECOND_TRIAL					  2
 #define NUMBER_OF_CONSECUTIVE_FAILURES    3
 
+/* Timer1 System Tick: F_Timer = 8MHz/8 = 1 MHz, one compare match per 1000 counts = 1 ms */
+#define SYSTEM_TICK_COMPARE_VALUE         999
+
+/*
+ * Doors: every door has its own motor, encoder, current sense and end-stop channels
+ * and runs its own sequence every system tick, the door number is the channels number.
+ */
+#define NUMBER_OF_DOORS                   2
+
+/* Door positions in encoder counts, the doors are locked at reset */
+#define DOOR_LOCKED_POSITION              0
+#define DOOR_UNLOCKED_POSITION            3600
+
+/* Waiting Times in system ticks (ms) */
+#define DOOR_TRAVEL_TIMEOUT_MS            15000 /* A longer move fails (jammed door or encoder fault) */
+#define DOOR_HOLDING_TIME_MS              3000
+
+/* Motor stall handling during the door moves */
+#define DOOR_STALL_BLANKING_MS            150  /* The start current of a move is not a stall */
+#define DOOR_END_OF_TRAVEL_COUNTS         100  /* A stall this close to the target is the end stop */
+#define DOOR_STALL_RETRIES                2    /* Then the move is abandoned and the alarm is raised */
+#define DOOR_RETRY_DELAY_MS               500
+
+/*
+ * Travel times learning: every move that ends at its position without a retry updates the
+ * running average of its travel time, new average = average + (time - average) / 4.
+ * The averages are saved in the EEPROM, a move timeout is then the learned time + 50% + 500 ms
+ * instead of the worst case DOOR_TRAVEL_TIMEOUT_MS. A move longer than its learned timeout goes on
+ * with the worst case timeout, its time is learned so a slower door raises the average.
+ */
+#define DOOR_LEARNING_ENABLE              TRUE
+#define DOOR_LEARNING_AVERAGE_SHIFT       2
+#define DOOR_TRAVEL_MARGIN_PERCENT        50
+#define DOOR_TRAVEL_MARGIN_MS             500
+/*
+ * Saving address in EEPROM of door 0, one block per door: valid marker,
+ * then the unlock and lock times (2 bytes each, LSB first)
+ */
+#define EEPROM_TRAVEL_TIMES_ADDRESS       0x0410
+#define EEPROM_TRAVEL_TIMES_BLOCK_SIZE    8
+#define EEPROM_TRAVEL_TIMES_MARKER        0xA5
+
 /*Control System Sequence*/
 #define VERIFY_NEW_PASSWORD		2
 #define MAIN_OPTIONS			3
 #define OPEN_DOOR				4
 #define CHANGE_PASSWORD			5
 
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+/* Door sequence, run every system tick */
+typedef enum {
+	DOOR_IDLE, DOOR_UNLOCKING, DOOR_HOLDING, DOOR_LOCKING
+}DoorStateType;
+
+/* Door moves, each one has its own learned travel time */
+typedef enum {
+	DOOR_MOVE_UNLOCK, DOOR_MOVE_LOCK, DOOR_NUM_MOVES
+}DoorMoveType;
+
+/* Result of a door move, every system tick: the HMI ECU is sent the door event or the door fault */
+typedef enum {
+	DOOR_RESULT_RUNNING, DOOR_RESULT_DONE, DOOR_RESULT_FAILED
+}DoorMoveResultType;
+
+/* Sequence of one door, run in the main context by the system tick and openDoor */
+typedef struct {
+	volatile DoorStateType state;
+	uint16 time;                          /* Time in the state, or since the move started (ms) */
+	DoorMoveType move;                    /* Running move, its target position and timeout */
+	sint32 target;
+	uint16 timeout;
+	uint16 attempt_time;                  /* Time since the last (re)start of the move */
+	uint8 retries;                        /* Stall retries of the move */
+	boolean retry_pending;
+	boolean interrupted;                  /* Braked by an obstruction or emergency stop, not a travel measure */
+	boolean held;                         /* Held by an active obstruction or emergency stop input */
+	uint16 travel_times[DOOR_NUM_MOVES];  /* Learned travel time of every move in ms, zero until learned */
+	volatile boolean travel_times_changed; /* Since they were saved */
+}DoorContextType;
+
+/* Time of the password hashes, measured with the Timer1 tick and count (1 usec) */
+typedef struct {
+	uint16 last_us;         /* Time of the last hash */
+	uint16 max_us;          /* Worst time since reset */
+	uint8 budget_misses;    /* Number of hashes above PASSWORD_HASH_BUDGET_US */
+}PasswordHashStatsType;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
@@ -45,16 +146,15 @@ void confirmPassword(void);
 void receiveTwoPasswords(void);
 
 /* Description:
- * Function to save a received password into EEPROM memory
- * The password is written to EEPROM memory at a specific address
- * Each element of the password array stored sequentially
+ * Function to save the credential of a received password into EEPROM memory:
+ * a new salt and the salted SHA-256 digest of the password, the password itself is not saved
  * */
 void savePassword(void);
 
 /*
  * Description :
- * - Function to compare between the input password at HMI ECU
- * and the stored password at EEPROM in Control ECU
+ * - Function to check the input password at HMI ECU
+ * against the credential stored at EEPROM in Control ECU
  * - Call the alarm if the two passwords are not matched
  * for a number of consecutive times
  * */
@@ -62,24 +162,59 @@ void checkPassword(void);
 
 /*
  * Description :
- * Function to receive a password from another ECU using UART and
- * read the stored password from EEPROM in the Control ECU.
+ * Function to receive a password from another ECU using UART.
  *
  * Parameters:
  * - receivedPassword: Array to store the received password.
- * - storedPassword: Array to store the password read from EEPROM.
  */
-void receive_read_Password(uint8 receivedPassword[PASSWORD_SIZE], uint8 storedPassword[PASSWORD_SIZE]);
+void receivePassword(uint8 receivedPassword[PASSWORD_SIZE]);
+
+/*
+ * Description :
+ * Function to get the time measurements of the password hashes
+ * */
+void getPasswordHashStats(PasswordHashStatsType *stats);
+
+/*
+ * Description :
+ * Callback function for timer1 to run the system tick (1 ms) tasks in the main context:
+ * the power statistics, encoder, end-stop and door tasks, once per new Timer1 tick count
+ * */
+void controlTick(void);
+
+/*
+ * Description :
+ * Function called in the main context with the ms elapsed since its last call, controlling every door using its DC-Motor:
+ * move to the unlocked position, hold, move to the locked position,
+ * the HMI ECU is told when each move ends, or that the door is faulty when a move fails.
+ * After an obstruction or emergency stop all the motors are braked, the work item posted by
+ * the ISR opens a locking door again, and the sequences are held while an input stays active
+ * */
+void doorControl(uint16 elapsed);
+
+/*
+ * Description :
+ * Function to start the sequence of the required door, it returns at once:
+ * a locked door is unlocked, an unlocked door is held again and a locking door is opened again
+ * */
+void openDoor(uint8 door);
+
+/*
+ * Description :
+ * Function to play the escalating alarm pattern for 1 Minute, it returns at once
+ * */
+void startAlarm(void);
 
 /*
  * Description :
- * Callback function for timer1, controlling the door using DC-Motor
+ * Function to read the learned travel times of every door from EEPROM memory,
+ * they stay unknown (zero) if the EEPROM has no valid travel times for the door
  * */
-void doorControl(void);
+void loadTravelTimes(void);
 
 /*
  * Description :
- * Callback Function to activate an alarm using Timer1 and Buzzer with for 1 Minute
+ * Function to save the learned travel times of every door into EEPROM memory if they changed
  * */
-void activateAlarm(void);
+void saveTravelTimes(void);
 #endif /* CONTROL_ECU_H_ */
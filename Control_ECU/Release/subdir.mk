@@ -6,35 +6,59 @@
 C_SRCS += \
 ../Control_ECU.c \
 ../Timer0_pwm.c \
+../adc.c \
 ../buzzer.c \
+../current_sense.c \
 ../dc_motor.c \
+../encoder.c \
+../end_stop.c \
+../estop.c \
 ../external_eeprom.c \
 ../gpio.c \
+../power.c \
+../sha256.c \
 ../timer1.c \
 ../twi.c \
-../uart.c 
+../uart.c \
+../work_queue.c 
 
 OBJS += \
 ./Control_ECU.o \
 ./Timer0_pwm.o \
+./adc.o \
 ./buzzer.o \
+./current_sense.o \
 ./dc_motor.o \
+./encoder.o \
+./end_stop.o \
+./estop.o \
 ./external_eeprom.o \
 ./gpio.o \
+./power.o \
+./sha256.o \
 ./timer1.o \
 ./twi.o \
-./uart.o 
+./uart.o \
+./work_queue.o 
 
 C_DEPS += \
 ./Control_ECU.d \
 ./Timer0_pwm.d \
+./adc.d \
 ./buzzer.d \
+./current_sense.d \
 ./dc_motor.d \
+./encoder.d \
+./end_stop.d \
+./estop.d \
 ./external_eeprom.d \
 ./gpio.d \
+./power.d \
+./sha256.d \
 ./timer1.d \
 ./twi.d \
-./uart.d 
+./uart.d \
+./work_queue.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -14,32 +14,150 @@
 #include "gpio.h"
 #include "std_types.h"
 #include "avr/io.h"
+#include <avr/interrupt.h> /* For Timer0 overflow ISR */
+#include <avr/pgmspace.h> /* For the duty cycle table in flash */
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Global variable to hold the address of the overflow call back function in the application */
+static void (*volatile g_callBackPtr)(void) = NULL_PTR;
+
+/* TRUE while the call back runs, an overflow ISR nested in it returns at once */
+static volatile boolean g_callBackRunning = FALSE;
+
+/* Compare value of every duty cycle percent, round(duty * 255 / 100) */
+static const uint8 PWM_Timer0_dutyTable[101] PROGMEM = {
+	  0,   3,   5,   8,  10,  13,  15,  18,  20,  23,
+	 26,  28,  31,  33,  36,  38,  41,  43,  46,  48,
+	 51,  54,  56,  59,  61,  64,  66,  69,  71,  74,
+	 76,  79,  82,  84,  87,  89,  92,  94,  97,  99,
+	102, 105, 107, 110, 112, 115, 117, 120, 122, 125,
+	128, 130, 133, 135, 138, 140, 143, 145, 148, 150,
+	153, 156, 158, 161, 163, 166, 168, 171, 173, 176,
+	178, 181, 184, 186, 189, 191, 194, 196, 199, 201,
+	204, 207, 209, 212, 214, 217, 219, 222, 224, 227,
+	230, 232, 235, 237, 240, 242, 245, 247, 250, 252,
+	255
+};
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+/*
+ * Timer0 Overflow ISR, once every PWM period. ISR_NOBLOCK enables the interrupts first,
+ * so the call back (the motor ramps, PI loops and software PWM) never delays another ISR.
+ * A call back longer than the PWM period would nest the ISR in itself: the running flag is
+ * checked and set with the interrupts disabled, the nested ISR returns and that overflow is skipped.
+ */
+ISR(TIMER0_OVF_vect, ISR_NOBLOCK)
+{
+	cli();
+	if(g_callBackRunning || (g_callBackPtr == NULL_PTR))
+	{
+		return;
+	}
+	g_callBackRunning = TRUE;
+	sei();
+	/* Call the Call Back function in the application at the end of the PWM period */
+	(*g_callBackPtr)();
+	g_callBackRunning = FALSE;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
 
 
 /*
  * Description :
  * Initialize the PWM module by:
- * 1. Trigger Timer0 with PWM Mode.
+ * 1. Setup the required PWM mode, Fast PWM or Phase Correct PWM.
  * 2. Setup the PWM mode with Non-Inverting.
- * 3. Setup the prescaler with F_CPU/8
- * 4. Setup the compare value based on the required input duty cycle
+ * 3. Setup the required prescaler, it selects the PWM frequency.
+ * 4. Start with zero duty cycle.
  * 5. Setup the direction for OC0 as output pin
  */
+void PWM_Timer0_init(const PWM_Timer0_ConfigType * Config_Ptr)
+{
+	TCNT0 = 0; // Set Timer Initial Value to 0
+	OCR0 = 0; // Set Compare Value
+	/* Configure timer control register
+	 * 1. Fast PWM Mode WGM01=1 & WGM00=1 or Phase Correct PWM Mode WGM01=0 & WGM00=1
+	 * 2. Clear OC0 when match occurs (non inverted mode) COM00=0 & COM01=1
+	 * 3. clock = the required prescaler CS02 CS01 CS00
+	 */
+	TCCR0 = (1<<WGM00) | (1<<COM01) | (Config_Ptr->prescaler & 0x07);
+	if(Config_Ptr->mode == PWM_TIMER0_FAST_MODE)
+	{
+		TCCR0 |= (1<<WGM01);
+	}
+	GPIO_setupPinDirectionInline(TIMER0_OC0_PORT_ID,TIMER0_OC0_PIN_ID,PIN_OUTPUT);
+}
+
+/*
+ * Description :
+ * Set the duty cycle (0 --> 100%) from the flash percent to compare value table.
+ * Only OCR0 is written, it is double buffered in the PWM modes so the new duty cycle
+ * starts with the next PWM period, the counter is not reset and the period is not cut.
+ * Values above 100% are taken as 100%.
+ */
+void PWM_Timer0_setDuty(uint8 duty_cycle)
+{
+	if(duty_cycle > 100)
+	{
+		duty_cycle = 100;
+	}
+	OCR0 = pgm_read_byte(&PWM_Timer0_dutyTable[duty_cycle]);
+}
 
+/*
+ * Description :
+ * Initialize the PWM module with Fast PWM and F_CPU/8 then set the required duty cycle,
+ * kept for the old callers, use PWM_Timer0_init once and PWM_Timer0_setDuty for every update.
+ */
 void PWM_Timer0_Start(uint8 duty_cycle)
 {
+	const PWM_Timer0_ConfigType config = { PWM_TIMER0_FAST_MODE, PWM_TIMER0_PRESCALER_8 };
 
-	TCNT0 = 0; // Set Timer Initial Value to 0
+	PWM_Timer0_init(&config);
+	PWM_Timer0_setDuty(duty_cycle);
+}
 
-	OCR0 = (uint8)(((uint32)(duty_cycle*255)/100)); // Set Compare Value
-	/* Configure timer control register
-	 * 1. Fast PWM mode FOC0=0
-	 * 2. Fast PWM Mode WGM01=1 & WGM00=1
-	 * 3. Clear OC0 when match occurs (non inverted mode) COM00=0 & COM01=1
-	 * 4. clock = F_CPU/8 CS00=0 CS01=1 CS02=0
-	 */
+/*
+ * Description :
+ * Write the compare value directly (0 --> 255) for a finer resolution than the percent,
+ * OCR0 is double buffered so the new value starts with the next PWM period without a glitch.
+ */
+void PWM_Timer0_setCompareValue(uint8 compare_value)
+{
+	OCR0 = compare_value;
+}
 
-	TCCR0 = (1<<WGM00) | (1<<WGM01) | (1<<COM01) | (1<<CS01);
+/*
+ * Description :
+ * Set the call back function called from the Timer0 overflow ISR once every PWM period.
+ */
+void PWM_Timer0_setCallBack(void(*a_ptr)(void))
+{
+	g_callBackPtr = a_ptr;
+}
 
-	GPIO_setupPinDirection(TIMER0_OC0_PORT_ID,TIMER0_OC0_PIN_ID,PIN_OUTPUT);
+/*
+ * Description :
+ * Enable or disable the Timer0 overflow interrupt, keep it disabled when the call back
+ * has nothing to do so the CPU is not woken up from idle sleep every PWM period.
+ */
+void PWM_Timer0_enableCallBack(boolean enable)
+{
+	if(enable)
+	{
+		TIMSK |= (1<<TOIE0);
+	}
+	else
+	{
+		TIMSK &= ~(1<<TOIE0);
+	}
 }
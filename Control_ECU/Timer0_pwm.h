@@ -13,6 +13,7 @@
 #define TIMER0_PWM_H_
 
 #include "std_types.h"
+#include <avr/io.h> /* To use the Timer0 Registers in the inline functions */
 
 /*******************************************************************************
  *                                Definitions                                  *
@@ -20,8 +21,101 @@
 #define TIMER0_OC0_PORT_ID			PORTB_ID
 #define TIMER0_OC0_PIN_ID			PIN3_ID
 
+/*
+ * PWM frequency: Fast PWM F_PWM = F_CPU/(N*256), Phase Correct PWM F_PWM = F_CPU/(N*510)
+ * With F_CPU = 8MHz and N = 8: Fast PWM 3.9 KHz, one Timer0 overflow every 256 usec
+ */
+#define TIMER0_PWM_PERIOD_US		256
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+typedef enum{
+	PWM_TIMER0_PHASE_CORRECT_MODE, PWM_TIMER0_FAST_MODE
+}PWM_Timer0_Mode;
+
+typedef enum{
+	PWM_TIMER0_NO_PRESCALING=1, PWM_TIMER0_PRESCALER_8, PWM_TIMER0_PRESCALER_64,
+	PWM_TIMER0_PRESCALER_256, PWM_TIMER0_PRESCALER_1024
+}PWM_Timer0_Prescaler;
+
+typedef struct {
+	PWM_Timer0_Mode mode;
+	PWM_Timer0_Prescaler prescaler;
+}PWM_Timer0_ConfigType;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
+/*
+ * Description :
+ * Initialize the PWM module by:
+ * 1. Setup the required PWM mode, Fast PWM or Phase Correct PWM.
+ * 2. Setup the PWM mode with Non-Inverting.
+ * 3. Setup the required prescaler, it selects the PWM frequency.
+ * 4. Start with zero duty cycle.
+ * 5. Setup the direction for OC0 as output pin
+ */
+void PWM_Timer0_init(const PWM_Timer0_ConfigType * Config_Ptr);
+
+/*
+ * Description :
+ * Set the duty cycle (0 --> 100%) from the flash percent to compare value table.
+ * Only OCR0 is written, it is double buffered in the PWM modes so the new duty cycle
+ * starts with the next PWM period, the counter is not reset and the period is not cut.
+ */
+void PWM_Timer0_setDuty(uint8 duty_cycle);
+
+/*
+ * Description :
+ * Initialize the PWM module with Fast PWM and F_CPU/8 then set the required duty cycle,
+ * kept for the old callers, use PWM_Timer0_init once and PWM_Timer0_setDuty for every update.
+ */
 void PWM_Timer0_Start(uint8 duty_cycle);
+
+/*
+ * Description :
+ * Write the compare value directly (0 --> 255), OCR0 is double buffered in fast PWM mode
+ * so the new value starts with the next PWM period without a glitch.
+ */
+void PWM_Timer0_setCompareValue(uint8 compare_value);
+
+/*
+ * Description :
+ * Set the call back function called from the Timer0 overflow ISR once every PWM period.
+ */
+void PWM_Timer0_setCallBack(void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Enable or disable the Timer0 overflow interrupt, keep it disabled when the call back
+ * has nothing to do so the CPU is not woken up from idle sleep every PWM period.
+ */
+void PWM_Timer0_enableCallBack(boolean enable);
+
+/*******************************************************************************
+ *                              Inline Functions                               *
+ *******************************************************************************/
+/*
+ * Inline versions for ISRs that must act within a few cycles (the emergency stop):
+ * they are always inlined, so the ISR has no call and does not save the call-clobbered registers first.
+ */
+
+/*
+ * Description :
+ * Inline version of PWM_Timer0_setCompareValue, one OUT instruction.
+ */
+static inline __attribute__((always_inline)) void PWM_Timer0_setCompareValueInline(uint8 compare_value)
+{
+	OCR0 = compare_value;
+}
+
+/*
+ * Description :
+ * Inline version of PWM_Timer0_enableCallBack(FALSE).
+ */
+static inline __attribute__((always_inline)) void PWM_Timer0_disableCallBackInline(void)
+{
+	TIMSK &= (uint8)~(1<<TOIE0);
+}
 #endif /* TIMER0_PWM_H_ */
@@ -0,0 +1,131 @@
+ /******************************************************************************
+ *
+ * Module: ADC
+ *
+ * File Name: adc.c
+ *
+ * Description: Source file for the ATmega32 ADC driver
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+
+#include "adc.h"
+#include <avr/io.h> /* To use the ADC Registers */
+#include <avr/interrupt.h> /* For ADC ISR */
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Global variable to hold the address of the conversion complete call back function */
+static void (*volatile g_callBackPtr)(void) = NULL_PTR;
+
+/* TRUE while the call back runs, an ADC ISR nested in it returns at once */
+static volatile boolean g_callBackRunning = FALSE;
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+/*
+ * ADC Conversion Complete ISR. ISR_NOBLOCK enables the interrupts first, so the call back
+ * never delays another ISR. A call back held longer than one conversion by the other ISRs
+ * would nest the ISR in itself: the running flag is checked and set with the interrupts
+ * disabled, the nested ISR returns and that sample is skipped.
+ */
+ISR(ADC_vect, ISR_NOBLOCK)
+{
+	cli();
+	if(g_callBackRunning || (g_callBackPtr == NULL_PTR))
+	{
+		return;
+	}
+	g_callBackRunning = TRUE;
+	sei();
+	/* Call the Call Back function in the application after every sample */
+	(*g_callBackPtr)();
+	g_callBackRunning = FALSE;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Function responsible for initialize the ADC driver:
+ * 1. Select the reference voltage, right adjusted result, channel 0.
+ * 2. Enable the ADC with the required clock prescaler, no conversion is started.
+ */
+void ADC_init(const ADC_ConfigType * Config_Ptr)
+{
+	/* ADMUX Register Bits Description:
+	 * REFS1:0 = Reference voltage
+	 * ADLAR   = 0 right adjusted
+	 * MUX4:0  = 00000 to choose channel 0 as initialization
+	 */
+	ADMUX = (Config_Ptr->ref_volt << REFS0);
+
+	/* ADCSRA Register Bits Description:
+	 * ADEN    = 1 Enable ADC
+	 * ADIE    = 0 Disable ADC Interrupt until the free running conversions start
+	 * ADATE   = 0 Disable Auto Trigger
+	 * ADPS2:0 = Required prescaler
+	 */
+	ADCSRA = (1<<ADEN) | (Config_Ptr->prescaler);
+}
+
+/*
+ * Description :
+ * Function to start the free running conversions of the required channel:
+ * 1. Select the channel (ADC0 --> ADC7), its PORTA pin must be an input without pull-up.
+ * 2. Auto trigger source = free running mode (ADTS2:0 = 000).
+ * 3. Enable the auto trigger and the conversion complete interrupt and start the first conversion,
+ *    every next conversion starts by itself when one is complete.
+ */
+void ADC_startFreeRunning(uint8 channel_num)
+{
+	ADMUX = (ADMUX & 0xE0) | (channel_num & 0x07);
+	SFIOR &= ~((1<<ADTS2) | (1<<ADTS1) | (1<<ADTS0));
+	ADCSRA |= (1<<ADATE) | (1<<ADIE) | (1<<ADSC);
+}
+
+/*
+ * Description :
+ * Function to change the channel of the free running conversions (ADC0 --> ADC7).
+ * In free running mode the next conversion starts with the interrupt flag,
+ * so a change from the conversion complete ISR is used by the conversion after the next one.
+ */
+void ADC_selectChannel(uint8 channel_num)
+{
+	ADMUX = (ADMUX & 0xE0) | (channel_num & 0x07);
+}
+
+/*
+ * Description :
+ * Function to stop the free running conversions, the current conversion completes
+ * without interrupt.
+ */
+void ADC_stopFreeRunning(void)
+{
+	ADCSRA &= ~((1<<ADATE) | (1<<ADIE));
+}
+
+/*
+ * Description :
+ * Function to set the conversion complete call back function address
+ */
+void ADC_setCallBack(void(*a_ptr)(void))
+{
+	g_callBackPtr = a_ptr;
+}
+
+/*
+ * Description :
+ * Function to return the last conversion result (0 --> 1023)
+ */
+uint16 ADC_getResult(void)
+{
+	return ADC;
+}
@@ -0,0 +1,88 @@
+ /******************************************************************************
+ *
+ * Module: ADC
+ *
+ * File Name: adc.h
+ *
+ * Description: header file for the ATmega32 ADC driver
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+
+#ifndef ADC_H_
+#define ADC_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+#define ADC_MAXIMUM_VALUE           1023
+#define ADC_NUM_OF_CHANNELS         8
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+typedef enum {
+	ADC_AREF, ADC_AVCC, ADC_INTERNAL_2_56V = 3
+}ADC_ReferenceVoltage;
+
+/*
+ * ADC clock = F_CPU / prescaler, it must be 50 --> 200 KHz for the 10-bit resolution.
+ * A conversion takes 13 ADC clocks: with F_CPU = 8MHz and 128, 62.5 KHz / 13 = 4.8 K samples/sec.
+ */
+typedef enum {
+	ADC_PRESCALER_2 = 1, ADC_PRESCALER_4, ADC_PRESCALER_8, ADC_PRESCALER_16,
+	ADC_PRESCALER_32, ADC_PRESCALER_64, ADC_PRESCALER_128
+}ADC_Prescaler;
+
+typedef struct {
+	ADC_ReferenceVoltage ref_volt;
+	ADC_Prescaler prescaler;
+}ADC_ConfigType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Function responsible for initialize the ADC driver with the required reference and clock.
+ */
+void ADC_init(const ADC_ConfigType * Config_Ptr);
+
+/*
+ * Description :
+ * Function to start the free running conversions of the required channel,
+ * the conversion complete interrupt calls the call back function after every sample.
+ */
+void ADC_startFreeRunning(uint8 channel_num);
+
+/*
+ * Description :
+ * Function to change the channel of the free running conversions, the conversion already
+ * started keeps the old channel: the new one is used from the conversion after it.
+ */
+void ADC_selectChannel(uint8 channel_num);
+
+/*
+ * Description :
+ * Function to stop the free running conversions after the current one.
+ */
+void ADC_stopFreeRunning(void);
+
+/*
+ * Description :
+ * Function to set the conversion complete call back function address
+ */
+void ADC_setCallBack(void(*a_ptr)(void));
+
+/*
+ * Description :
+ * Function to return the last conversion result (0 --> 1023),
+ * it is read from the call back before the next conversion overwrites it.
+ */
+uint16 ADC_getResult(void);
+
+#endif /* ADC_H_ */
@@ -4,47 +4,245 @@
  *
  * File Name: buzzer.c
  *
- * Description: Source file for the Buzzer driver
+ * Description: Source file for the Buzzer driver (Timer2 tone patterns)
  *
  * Author: Kareem Abd El-Moneam
  *
  *******************************************************************************/
 #include "buzzer.h"
 #include "gpio.h"
+#include <avr/io.h> /* To use Timer2 Registers */
+#include <avr/interrupt.h> /* For Timer2 ISR */
+#include <avr/pgmspace.h> /* For the pattern tables in flash */
+#include <util/atomic.h> /* To start a pattern while the Timer2 ISR may run */
+
 /*******************************************************************************
- *                      Functions Definitions                                  *
+ *                                Definitions                                  *
+ *******************************************************************************/
+/* OCR2 value of a tone frequency in Hz */
+#define BUZZER_OCR(hz)           ((uint8)((BUZZER_TONE_BASE_HZ / (hz)) - 1))
+/* Number of compare matches (2 per tone period) during ms with the required OCR2 value */
+#define BUZZER_MATCHES(ocr, ms)  ((uint16)(((uint32)(ms) * 2UL * BUZZER_TONE_BASE_HZ) / (1000UL * ((ocr) + 1))))
+
+/* Pattern steps: a tone, a silence (1 KHz compare matches with OC2 disconnected) or the end */
+#define BUZZER_TONE(hz, ms)      { BUZZER_OCR(hz), TRUE, BUZZER_MATCHES(BUZZER_OCR(hz), ms) }
+#define BUZZER_REST_OCR          BUZZER_OCR(500)
+#define BUZZER_REST(ms)          { BUZZER_REST_OCR, FALSE, BUZZER_MATCHES(BUZZER_REST_OCR, ms) }
+#define BUZZER_END               { 0, FALSE, 0 }
+
+/* Pattern without a repeated part */
+#define BUZZER_NO_LOOP           0xFF
+
+/*******************************************************************************
+ *                         Types Declaration (Private)                         *
+ *******************************************************************************/
+typedef struct {
+	uint8 ocr;            /* OCR2 value: tone frequency */
+	boolean tone;         /* OC2 toggles, or stays low for a silence */
+	uint16 matches;       /* Step duration in compare matches, zero at the end of the pattern */
+}Buzzer_StepType;
+
+typedef struct {
+	const Buzzer_StepType *steps;
+	uint8 loop_step;      /* First step of the repeated part, or BUZZER_NO_LOOP */
+	uint8 loop_repeats;   /* Number of times the repeated part is played again */
+}Buzzer_PatternType;
+
+/*******************************************************************************
+ *                         Flash Tables (Private)                              *
+ *******************************************************************************/
+/* Short high tick */
+static const Buzzer_StepType Buzzer_keyClick[] PROGMEM = {
+	BUZZER_TONE(4000, 5),
+	BUZZER_END
+};
+
+/* Two rising notes */
+static const Buzzer_StepType Buzzer_success[] PROGMEM = {
+	BUZZER_TONE(2000, 60),
+	BUZZER_REST(30),
+	BUZZER_TONE(3000, 90),
+	BUZZER_END
+};
+
+/* Two falling low notes */
+static const Buzzer_StepType Buzzer_failure[] PROGMEM = {
+	BUZZER_TONE(400, 300),
+	BUZZER_REST(100),
+	BUZZER_TONE(300, 400),
+	BUZZER_END
+};
+
+/*
+ * Escalating alarm: 3 slow low beeps (3 sec), 5 faster high beeps (2.5 sec),
+ * then the two-tone siren (0.5 sec) played 109 times, 60 sec in total.
+ */
+static const Buzzer_StepType Buzzer_alarm[] PROGMEM = {
+	BUZZER_TONE(1000, 200), BUZZER_REST(800),
+	BUZZER_TONE(1000, 200), BUZZER_REST(800),
+	BUZZER_TONE(1000, 200), BUZZER_REST(800),
+	BUZZER_TONE(2000, 150), BUZZER_REST(350),
+	BUZZER_TONE(2000, 150), BUZZER_REST(350),
+	BUZZER_TONE(2000, 150), BUZZER_REST(350),
+	BUZZER_TONE(2000, 150), BUZZER_REST(350),
+	BUZZER_TONE(2000, 150), BUZZER_REST(350),
+	/* Step 16: siren */
+	BUZZER_TONE(2500, 250), BUZZER_TONE(3200, 250),
+	BUZZER_END
+};
+
+/* Patterns indexed by Buzzer_PatternIdType */
+static const Buzzer_PatternType Buzzer_patterns[BUZZER_NUM_PATTERNS] PROGMEM = {
+	{ Buzzer_keyClick, BUZZER_NO_LOOP, 0 },
+	{ Buzzer_success, BUZZER_NO_LOOP, 0 },
+	{ Buzzer_failure, BUZZER_NO_LOOP, 0 },
+	{ Buzzer_alarm, 16, 108 }
+};
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+/* Playing pattern, its steps in flash, next step and repeats left */
+static volatile boolean g_playing = FALSE;
+static Buzzer_PatternIdType g_pattern = BUZZER_KEY_CLICK;
+static const Buzzer_StepType *g_steps = NULL_PTR;
+static uint8 g_nextStep = 0;
+static uint8 g_repeatsLeft = 0;
+/* Compare matches left in the playing step */
+static uint16 g_matchesLeft = 0;
+
+/*******************************************************************************
+ *                      Functions Definitions (Private)                        *
  *******************************************************************************/
 
 /*
  * Description :
- * Setup the direction for the buzzer pin as output pin through the GPIO driver.
- * Turn off the buzzer through the GPIO.
+ * Private function to stop Timer2 (no clock) with OC2 disconnected, the pin stays low.
  */
-void Buzzer_init()
+static void Buzzer_stopTimer(void)
 {
-	GPIO_setupPinDirection(BUZZER_PORT_ID,BUZZER_PIN_ID,PIN_OUTPUT);
-	GPIO_writePin(BUZZER_PORT_ID,BUZZER_PIN_ID,LOGIC_LOW);
+	TCCR2 = 0;
+	TIMSK &= (uint8)~(1<<OCIE2);
+	g_playing = FALSE;
 }
 
 /*
  * Description :
- * Function to enable the Buzzer through the GPIO.
+ * Private function to start the next step of the playing pattern:
+ * 1. At the end of the steps go back to the repeated part if repeats are left, else stop.
+ * 2. Tone: CTC mode with OC2 toggle (COM20 = 1), silence: CTC mode with OC2 disconnected.
+ *    The counter restarts from zero so the new OCR2 can not be below it.
  */
-void Buzzer_on(void)
+static void Buzzer_startStep(void)
+{
+	const Buzzer_StepType *step = &g_steps[g_nextStep];
+	uint16 matches = pgm_read_word(&step->matches);
+
+	if(matches == 0)
+	{
+		if(g_repeatsLeft == 0)
+		{
+			Buzzer_stopTimer();
+			return;
+		}
+		g_repeatsLeft--;
+		g_nextStep = pgm_read_byte(&Buzzer_patterns[g_pattern].loop_step);
+		step = &g_steps[g_nextStep];
+		matches = pgm_read_word(&step->matches);
+	}
+	g_nextStep++;
+	g_matchesLeft = matches;
+
+	OCR2 = pgm_read_byte(&step->ocr);
+	TCNT2 = 0;
+	/* CTC mode WGM21 = 1, clock = F_CPU/64 CS22 = 1 */
+	if(pgm_read_byte(&step->tone))
+	{
+		TCCR2 = (1<<WGM21) | (1<<COM20) | (1<<CS22);
+	}
+	else
+	{
+		TCCR2 = (1<<WGM21) | (1<<CS22);
+	}
+}
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+/* Timer2 Compare Match ISR, one per half period of the tone: count the step duration */
+ISR(TIMER2_COMP_vect)
 {
-	GPIO_writePin(BUZZER_PORT_ID,BUZZER_PIN_ID,LOGIC_HIGH);
+	if(--g_matchesLeft == 0)
+	{
+		Buzzer_startStep();
+	}
 }
 
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
 /*
  * Description :
- * Function to disable the Buzzer through the GPIO.
+ * Setup the buzzer pin as output pin through the GPIO driver, low while nothing plays
+ * (OC2 disconnected).
  */
-void Buzzer_off(void)
+void Buzzer_init(void)
 {
-	GPIO_writePin(BUZZER_PORT_ID,BUZZER_PIN_ID,LOGIC_LOW);
-
+	Buzzer_stopTimer();
+	GPIO_writePinInline(BUZZER_PORT_ID,BUZZER_PIN_ID,LOGIC_LOW);
+	GPIO_setupPinDirectionInline(BUZZER_PORT_ID,BUZZER_PIN_ID,PIN_OUTPUT);
 }
 
+/*
+ * Description :
+ * Start playing the required pattern from its first step, unless a pattern of a higher
+ * priority is playing. The rest of the pattern is played by the Timer2 ISR.
+ */
+void Buzzer_play(Buzzer_PatternIdType pattern)
+{
+	if(pattern >= BUZZER_NUM_PATTERNS)
+	{
+		return;
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if(g_playing && (pattern < g_pattern))
+		{
+			/* Do Nothing */
+		}
+		else
+		{
+			g_pattern = pattern;
+			g_steps = (const Buzzer_StepType *)pgm_read_ptr(&Buzzer_patterns[pattern].steps);
+			g_repeatsLeft = pgm_read_byte(&Buzzer_patterns[pattern].loop_repeats);
+			g_nextStep = 0;
+			g_playing = TRUE;
+			Buzzer_startStep();
+			TIFR = (1<<OCF2);
+			TIMSK |= (1<<OCIE2);
+		}
+	}
+}
 
+/*
+ * Description :
+ * Stop the playing pattern and Timer2.
+ */
+void Buzzer_stop(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Buzzer_stopTimer();
+	}
+}
 
-
+/*
+ * Description :
+ * Return TRUE while a pattern is playing.
+ */
+boolean Buzzer_isPlaying(void)
+{
+	return g_playing;
+}
@@ -4,7 +4,7 @@
  *
  * File Name: buzzer.h
  *
- * Description: Header file for the Buzzer driver
+ * Description: Header file for the Buzzer driver (Timer2 tone patterns)
  *
  * Author: Kareem Abd El-Moneam
  *
@@ -13,34 +13,61 @@
 #ifndef BUZZER_H_
 #define BUZZER_H_
 
+#include "std_types.h"
+
 /*******************************************************************************
  *                                Definitions                                  *
  *******************************************************************************/
-#define BUZZER_PORT_ID   		 PORTC_ID
-#define BUZZER_PIN_ID  			 PIN2_ID
+/* The buzzer is driven by the Timer2 compare output OC2 */
+#define BUZZER_PORT_ID   		 PORTD_ID
+#define BUZZER_PIN_ID  			 PIN7_ID
+
+/*
+ * Timer2 CTC mode with F_CPU/64, OC2 toggles on every compare match:
+ * F_Tone = 8MHz / (2 * 64 * (1 + OCR2)) = 62500 / (1 + OCR2), 245 Hz --> 31 KHz.
+ * The notes are timed by counting the compare matches (half periods) in the Timer2 ISR.
+ */
+#define BUZZER_TONE_BASE_HZ      62500UL
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+/*
+ * Tone patterns stored in flash, in priority order: a playing pattern is only replaced
+ * by a pattern of the same or a higher priority.
+ * BUZZER_ALARM escalates from slow low beeps to a fast two-tone siren and lasts 1 minute.
+ */
+typedef enum {
+	BUZZER_KEY_CLICK, BUZZER_SUCCESS, BUZZER_FAILURE, BUZZER_ALARM, BUZZER_NUM_PATTERNS
+}Buzzer_PatternIdType;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
 
 /*
  * Description :
- * Setup the direction for the buzzer pin as output pin through the GPIO driver.
- * Turn off the buzzer through the GPIO.
+ * Setup the buzzer pin as output pin through the GPIO driver, it stays low while nothing plays.
  */
-void Buzzer_init();
+void Buzzer_init(void);
 
 /*
  * Description :
- * Function to enable the Buzzer through the GPIO.
+ * Start playing the required pattern, it is played by Timer2 and its ISR and the function
+ * returns at once. It can be called from an ISR.
  */
-void Buzzer_on(void);
-
+void Buzzer_play(Buzzer_PatternIdType pattern);
 
 /*
  * Description :
- * Function to disable the Buzzer through the GPIO.
+ * Stop the playing pattern and Timer2.
  */
-void Buzzer_off(void);
+void Buzzer_stop(void);
 
+/*
+ * Description :
+ * Return TRUE while a pattern is playing.
+ */
+boolean Buzzer_isPlaying(void);
 
 #endif /* BUZZER_H_ */
@@ -0,0 +1,207 @@
+ /******************************************************************************
+ *
+ * Module: Current Sense
+ *
+ * File Name: current_sense.c
+ *
+ * Description: Source file for the door motors current sensing and stall detection
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+#include "current_sense.h"
+#include "adc.h"
+#include "gpio.h"
+#include "timer1.h"
+#include "work_queue.h"
+#include <util/atomic.h> /* To read the sums updated by the ADC ISR */
+
+/*******************************************************************************
+ *                         Types Declaration (Private)                         *
+ *******************************************************************************/
+/* Moving average and stall timing of a current channel */
+typedef struct {
+	/* Last samples and their sum */
+	uint16 samples[CURRENT_SENSE_AVERAGE_SAMPLES];
+	volatile uint16 samples_sum;
+	uint8 sample_index;
+	/* ADC ISR: the side of the threshold of the last posted overload work item, and TRUE while it is queued */
+	boolean posted_above;
+	volatile boolean overload_posted;
+	/* Main context: the average is above the threshold since the Timer1 tick count overload_start */
+	boolean overloaded;
+	boolean stalled;
+	uint16 overload_start;
+}CurrentSense_ChannelType;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+/* ADC input of every channel */
+static const uint8 CurrentSense_adcChannels[CURRENT_SENSE_NUM_CHANNELS] = {
+	CURRENT_SENSE0_ADC_CHANNEL,
+#if (CURRENT_SENSE_NUM_CHANNELS > 1)
+	CURRENT_SENSE1_ADC_CHANNEL,
+#endif
+};
+
+static CurrentSense_ChannelType g_channels[CURRENT_SENSE_NUM_CHANNELS];
+
+/*
+ * Channels of the free running conversions: the conversion that just completed,
+ * and the one selected in the ADC (the running conversion started with it).
+ */
+static uint8 g_resultChannel = 0;
+static uint8 g_selectedChannel = 0;
+
+/*******************************************************************************
+ *                      Functions Definitions (Private)                        *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Private function to return the moving average of a channel in ADC steps.
+ */
+static uint16 CurrentSense_getAverage(uint8 channel)
+{
+	uint16 sum;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		sum = g_channels[channel].samples_sum;
+	}
+	return sum >> CURRENT_SENSE_AVERAGE_SHIFT;
+}
+
+/*
+ * Description :
+ * Private work item posted by the ADC ISR when the average current crosses the stall threshold,
+ * run in the main context: the overload starts at the Timer1 tick count of the first run above
+ * the threshold and ends below it. The average is read again here, a crossing back while
+ * the item was queued is seen, and posted again by the ISR.
+ */
+static void CurrentSense_overloadTask(uint8 channel_num)
+{
+	CurrentSense_ChannelType *channel = &g_channels[channel_num];
+
+	/* A crossing from now on posts the work item again */
+	channel->overload_posted = FALSE;
+	if(CurrentSense_getAverage(channel_num) >= CURRENT_SENSE_MA_TO_ADC(CURRENT_SENSE_STALL_MA))
+	{
+		if(!channel->overloaded)
+		{
+			channel->overloaded = TRUE;
+			channel->overload_start = Timer1_getTicks();
+		}
+	}
+	else
+	{
+		channel->overloaded = FALSE;
+		channel->stalled = FALSE;
+	}
+}
+
+/*
+ * Description :
+ * Private function called from the ADC conversion complete ISR for every sample,
+ * with the interrupts enabled (ISR_NOBLOCK):
+ * 1. Replace the oldest sample of the window of the channel the sample belongs to,
+ *    the sum is updated with one subtraction and one addition.
+ * 2. If the average is on the other side of the stall threshold than the last posted work item,
+ *    post the overload work item of the channel, unless it is still in the queue
+ *    (one item per channel at most). It is retried with the next sample if the queue is full.
+ *    The post is done with the interrupts disabled, the work queue has one producer at a time.
+ * 3. The next conversion already started with the selected channel,
+ *    select the next channel in turn for the conversion after it.
+ */
+static void CurrentSense_sampleTask(void)
+{
+	CurrentSense_ChannelType *channel = &g_channels[g_resultChannel];
+	uint16 sample = ADC_getResult();
+	boolean above;
+
+	channel->samples_sum = channel->samples_sum - channel->samples[channel->sample_index] + sample;
+	channel->samples[channel->sample_index] = sample;
+	channel->sample_index = (channel->sample_index + 1) & (CURRENT_SENSE_AVERAGE_SAMPLES - 1);
+
+	above = (channel->samples_sum >=
+			(CURRENT_SENSE_MA_TO_ADC(CURRENT_SENSE_STALL_MA) << CURRENT_SENSE_AVERAGE_SHIFT));
+	if((above != channel->posted_above) && !channel->overload_posted)
+	{
+		ATOMIC_BLOCK(ATOMIC_FORCEON)
+		{
+			if(WorkQueue_postInline(CurrentSense_overloadTask, g_resultChannel))
+			{
+				channel->overload_posted = TRUE;
+				channel->posted_above = above;
+			}
+		}
+	}
+
+#if (CURRENT_SENSE_NUM_CHANNELS > 1)
+	g_resultChannel = g_selectedChannel;
+	g_selectedChannel++;
+	if(g_selectedChannel == CURRENT_SENSE_NUM_CHANNELS)
+	{
+		g_selectedChannel = 0;
+	}
+	ADC_selectChannel(CurrentSense_adcChannels[g_selectedChannel]);
+#endif
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the current sensing:
+ * 1. Shunt channels pins as inputs without pull-ups.
+ * 2. ADC with AVCC reference and F_CPU/128 (4.8 K samples/sec).
+ * 3. Start the free running conversions on channel 0, the samples are filtered from the ADC ISR.
+ */
+void CurrentSense_init(void)
+{
+	const ADC_ConfigType adcConfig = { ADC_AVCC, ADC_PRESCALER_128 };
+	uint8 channel;
+
+	for(channel = 0; channel < CURRENT_SENSE_NUM_CHANNELS; channel++)
+	{
+		GPIO_setupPinDirection(PORTA_ID, CurrentSense_adcChannels[channel], PIN_INPUT);
+		GPIO_writePin(PORTA_ID, CurrentSense_adcChannels[channel], LOGIC_LOW);
+	}
+
+	g_resultChannel = 0;
+	g_selectedChannel = 0;
+	ADC_init(&adcConfig);
+	ADC_setCallBack(CurrentSense_sampleTask);
+	ADC_startFreeRunning(CurrentSense_adcChannels[0]);
+}
+
+/*
+ * Description :
+ * Return the moving average of the motor current in mA.
+ */
+uint16 CurrentSense_getMilliAmps(uint8 channel)
+{
+	return (uint16)(((uint32)CurrentSense_getAverage(channel) * 1000UL * CURRENT_SENSE_REF_MV)
+			/ (CURRENT_SENSE_MV_PER_AMP * 1024UL));
+}
+
+/*
+ * Description :
+ * Return TRUE while the average current is above the stall threshold for STALL_TIME_MS or more,
+ * measured with the Timer1 tick count from the start of the overload. The stall is latched until
+ * the overload ends, so a long overload is not lost when the 16-bit tick count wraps.
+ */
+boolean CurrentSense_isStalled(uint8 channel_num)
+{
+	CurrentSense_ChannelType *channel = &g_channels[channel_num];
+
+	if(channel->overloaded && !channel->stalled &&
+			((uint16)(Timer1_getTicks() - channel->overload_start) >= CURRENT_SENSE_STALL_TIME_MS))
+	{
+		channel->stalled = TRUE;
+	}
+	return channel->stalled;
+}
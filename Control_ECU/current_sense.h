@@ -0,0 +1,80 @@
+ /******************************************************************************
+ *
+ * Module: Current Sense
+ *
+ * File Name: current_sense.h
+ *
+ * Description: Header file for the door motors current sensing and stall detection
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+
+#ifndef CURRENT_SENSE_H_
+#define CURRENT_SENSE_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+/*
+ * One channel per door motor (1 --> 2 channels), H-bridge low side shunt amplifier outputs:
+ * channel 0 on ADC0 (PA0), channel 1 on ADC3 (PA3).
+ * The free running ADC samples the channels in turn.
+ */
+#define CURRENT_SENSE_NUM_CHANNELS      2
+#define CURRENT_SENSE0_ADC_CHANNEL      0
+#define CURRENT_SENSE1_ADC_CHANNEL      3
+
+/*
+ * Scale: 0.1 ohm shunt with a x20 amplifier = 2000 mV/A, ADC reference AVCC = 5000 mV,
+ * one ADC step = 5000 / 1024 / 2000 = 2.44 mA
+ */
+#define CURRENT_SENSE_MV_PER_AMP        2000
+#define CURRENT_SENSE_REF_MV            5000
+#define CURRENT_SENSE_MA_TO_ADC(ma)     ((uint16)(((uint32)(ma) * CURRENT_SENSE_MV_PER_AMP * 1024UL) \
+										/ (1000UL * CURRENT_SENSE_REF_MV)))
+
+/*
+ * Moving average of the last 2^SHIFT samples of a channel: 32 samples at 4.8 / 2 K samples/sec
+ * = 13.3 msec, 52 periods of the 3.9 KHz hardware PWM or 3 periods of the 244 Hz software PWM
+ * so the chopped current is smoothed. 32 * 1023 fits the 16-bit sum.
+ */
+#define CURRENT_SENSE_AVERAGE_SHIFT     5
+#define CURRENT_SENSE_AVERAGE_SAMPLES   (1 << CURRENT_SENSE_AVERAGE_SHIFT)
+
+/*
+ * Stall: the average current stays above the threshold for STALL_TIME_MS.
+ * A stalled motor or a bolt at its end stop draws the stall current, a running door
+ * stays well below it; the start current is masked by the caller (blanking time).
+ */
+#define CURRENT_SENSE_STALL_MA          1200
+#define CURRENT_SENSE_STALL_TIME_MS     80
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the current sensing: the ADC in free running mode on the shunt channels in turn,
+ * every sample is added to the moving average of its channel from the ADC conversion complete ISR.
+ * The ISR posts a work item when the average crosses the stall threshold, the stall time
+ * is counted from it in the main context (WorkQueue_runPending).
+ */
+void CurrentSense_init(void);
+
+/*
+ * Description :
+ * Return the moving average of the motor current in mA.
+ */
+uint16 CurrentSense_getMilliAmps(uint8 channel);
+
+/*
+ * Description :
+ * Return TRUE while the average current is above the stall threshold for STALL_TIME_MS or more.
+ */
+boolean CurrentSense_isStalled(uint8 channel);
+
+#endif /* CURRENT_SENSE_H_ */
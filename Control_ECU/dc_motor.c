@@ -2,7 +2,7 @@
  *
  * Module: DC Motor
  *
- * File Name: dc_motor.h
+ * File Name: dc_motor.c
  *
  * Description: source file for the DC Motor driver
  *
@@ -13,47 +13,688 @@
 #include "gpio.h"
 #include "std_types.h"
 #include "Timer0_pwm.h"
+#include "encoder.h"
+#include <avr/pgmspace.h> /* For the ramp curves in flash */
+#include <util/atomic.h> /* To pass the ramp targets to the Timer0 ISR */
+
+/*******************************************************************************
+ *                         Types Declaration (Private)                         *
+ *******************************************************************************/
+/* Enable output of a motor channel */
+typedef enum {
+	DC_MOTOR_PWM_OC0, DC_MOTOR_PWM_SOFTWARE
+}DcMotor_PwmType;
+
+/* Pins of a motor channel, the enable pin is only driven by the software PWM */
+typedef struct {
+	uint8 in1_port;
+	uint8 in1_pin;
+	uint8 in2_port;
+	uint8 in2_pin;
+	DcMotor_PwmType pwm;
+	uint8 en_port;
+	uint8 en_pin;
+}DcMotor_ChannelConfigType;
+
+/* Ramp and move state of a motor channel */
+typedef struct {
+	/* Targets of the last DcMotor_Rotate call, read by the ramp task */
+	volatile DcMotor_State target_state;
+	volatile uint8 target_duty;
+	/* Set by DcMotor_Rotate, the ramp task plans a new ramp from the current duty */
+	volatile boolean ramp_request;
+	/* A ramp is running */
+	volatile boolean ramp_active;
+
+	/* Motor output owned by the timer task: H-bridge state and enable duty (0 --> 255) */
+	DcMotor_State current_state;
+	uint8 current_duty;
+
+	/* Running ramp */
+	uint8 ramp_from;
+	uint8 ramp_to;
+	uint8 ramp_step;
+	uint8 ramp_countdown;
+	uint8 ramp_step_overflows;
+	DcMotor_RampCurve ramp_curve;
+
+	/* Target of the last DcMotor_moveTo call, in encoder counts */
+	volatile sint32 move_target;
+	/* Set by DcMotor_moveTo, the move starts when the motor is stopped */
+	volatile boolean move_request;
+	/* A closed loop move is running */
+	volatile boolean move_active;
+
+	/* Running move: PI loop state */
+	uint16 speed_set_point;
+	sint32 integral;
+}DcMotor_ChannelType;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+/*
+ * Ramp curves: the fraction (0 --> 255) of the speed change done after every ramp step.
+ * The S-curve is smoothstep 3x^2 - 2x^3, the acceleration starts and ends softly
+ * so the gearbox backlash is taken up without a shock.
+ */
+static const uint8 DcMotor_curves[DC_MOTOR_NUM_CURVES][DC_MOTOR_RAMP_STEPS] PROGMEM = {
+	/* DC_MOTOR_CURVE_LINEAR */
+	{   8,  16,  24,  32,  40,  48,  56,  64,  72,  80,  88,  96, 104, 112, 120, 128,
+	  135, 143, 151, 159, 167, 175, 183, 191, 199, 207, 215, 223, 231, 239, 247, 255 },
+	/* DC_MOTOR_CURVE_S */
+	{   1,   3,   6,  11,  17,  24,  31,  40,  49,  59,  70,  81,  92, 104, 116, 128,
+	  139, 151, 163, 174, 185, 196, 206, 215, 224, 231, 238, 244, 249, 252, 254, 255 }
+};
+
+/* Channels pins: H-bridge inputs and the enable output */
+static const DcMotor_ChannelConfigType DcMotor_channelConfigs[DC_MOTOR_NUM_CHANNELS] = {
+	{ DC_MOTOR0_IN1_PORT_ID, DC_MOTOR0_IN1_PIN_ID, DC_MOTOR0_IN2_PORT_ID, DC_MOTOR0_IN2_PIN_ID,
+	  DC_MOTOR_PWM_OC0, TIMER0_OC0_PORT_ID, TIMER0_OC0_PIN_ID },
+#if (DC_MOTOR_NUM_CHANNELS > 1)
+	{ DC_MOTOR1_IN1_PORT_ID, DC_MOTOR1_IN1_PIN_ID, DC_MOTOR1_IN2_PORT_ID, DC_MOTOR1_IN2_PIN_ID,
+	  DC_MOTOR_PWM_SOFTWARE, DC_MOTOR1_EN_PORT_ID, DC_MOTOR1_EN_PIN_ID },
+#endif
+};
+
+/* Ramp and move state of every channel */
+static DcMotor_ChannelType g_channels[DC_MOTOR_NUM_CHANNELS];
+
+/* Timer0 overflows counter: software PWM phase and the channels PI loops slots */
+static uint8 g_overflows = 0;
+
+/* Set by the emergency stop ISRs, the motor outputs are not written until DcMotor_brake */
+volatile boolean g_dcMotorOutputsLocked = FALSE;
+
+/*******************************************************************************
+ *                      Functions Definitions (Private)                        *
+ *******************************************************************************/
 
 /*
  * Description :
- * The Function responsible for setup the direction for the two motor pins through the GPIO driver.
- * */
-void DcMotor_init(void)
+ * Private function to write a motor port with a set/clear mask pair, unless the outputs are locked
+ * by the emergency stop. The lock is checked with the interrupts disabled, so the brake can not
+ * come between the check and the write.
+ */
+static void DcMotor_writePortMasked(uint8 port_num, uint8 set_mask, uint8 clear_mask)
 {
-	GPIO_setupPinDirection(DC_MOTOR_IN1_PORT_ID, DC_MOTOR_IN1_PIN_ID, PIN_OUTPUT);
-	GPIO_setupPinDirection(DC_MOTOR_IN2_PORT_ID, DC_MOTOR_IN2_PIN_ID, PIN_OUTPUT);
-	/* Stop the DC-Motor at the beginning through the GPIO driver */
-	GPIO_writePin(DC_MOTOR_IN1_PORT_ID, DC_MOTOR_IN1_PIN_ID, LOGIC_LOW);
-	GPIO_writePin(DC_MOTOR_IN2_PORT_ID, DC_MOTOR_IN2_PIN_ID, LOGIC_LOW);
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if(!g_dcMotorOutputsLocked)
+		{
+			GPIO_writePortMasked(port_num, set_mask, clear_mask);
+		}
+	}
 }
 
 /*
  * Description :
- * The function responsible for rotate the DC Motor CW/ or A-CW or stop
- * the motor based on the state input state value.
- * Send the required duty cycle to the PWM driver based on the required speed value.
+ * Private function to write the two H-bridge inputs of a channel together, so the bridge never
+ * passes through an intermediate state (e.g. brake IN1=IN2=1 while changing from CW to A-CW):
+ * 1. IN1 and IN2 on the same port: one interrupt safe masked write.
+ * 2. IN1 and IN2 on different ports: one GPIO transaction, the two ports are written
+ *    back to back with the interrupts disabled.
+ * Nothing is written while the outputs are locked by the emergency stop.
  */
-void DcMotor_Rotate(DcMotor_State state, uint8 speed)
+static void DcMotor_writeInputs(uint8 motor, uint8 in1, uint8 in2)
 {
+	const DcMotor_ChannelConfigType *config = &DcMotor_channelConfigs[motor];
+	GPIO_TransactionType transaction;
+	uint8 set_mask = 0;
+
+	if(config->in1_port == config->in2_port)
+	{
+		if(in1 == LOGIC_HIGH)
+		{
+			set_mask |= (1<<config->in1_pin);
+		}
+		if(in2 == LOGIC_HIGH)
+		{
+			set_mask |= (1<<config->in2_pin);
+		}
+		DcMotor_writePortMasked(config->in1_port, set_mask,
+				(1<<config->in1_pin) | (1<<config->in2_pin));
+	}
+	else
+	{
+		GPIO_initTransaction(&transaction);
+		GPIO_transactionWritePin(&transaction, config->in1_port, config->in1_pin, in1);
+		GPIO_transactionWritePin(&transaction, config->in2_port, config->in2_pin, in2);
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			if(!g_dcMotorOutputsLocked)
+			{
+				GPIO_commitTransaction(&transaction);
+			}
+		}
+	}
+}
+
+/*
+ * Description :
+ * Private function to change the H-bridge state of a channel, its encoder counts in the new
+ * direction if it has no direction channel. A stopped motor coasts with IN1 = IN2 = 0,
+ * a braked one has its terminals shorted with IN1 = IN2 = 1.
+ */
+static void DcMotor_setState(uint8 motor, DcMotor_State state)
+{
+	g_channels[motor].current_state = state;
 	switch(state)
 	{
 	case STOP:
-		/* Stop DC Motor */
-		GPIO_writePin(DC_MOTOR_IN1_PORT_ID, DC_MOTOR_IN1_PIN_ID, LOGIC_LOW);
-		GPIO_writePin(DC_MOTOR_IN2_PORT_ID, DC_MOTOR_IN2_PIN_ID, LOGIC_LOW);
+		DcMotor_writeInputs(motor, LOGIC_LOW, LOGIC_LOW);
 		break;
 	case cw:
-		/* Clockwise Rotation */
-		GPIO_writePin(DC_MOTOR_IN1_PORT_ID, DC_MOTOR_IN1_PIN_ID, LOGIC_LOW);
-		GPIO_writePin(DC_MOTOR_IN2_PORT_ID, DC_MOTOR_IN2_PIN_ID, LOGIC_HIGH);
+		DcMotor_writeInputs(motor, LOGIC_LOW, LOGIC_HIGH);
+		Encoder_setCountDirection(motor, ENCODER_FORWARD);
 		break;
 	case ACW:
-		/* Stop DC Motor */
-		GPIO_writePin(DC_MOTOR_IN1_PORT_ID, DC_MOTOR_IN1_PIN_ID, LOGIC_HIGH);
-		GPIO_writePin(DC_MOTOR_IN2_PORT_ID, DC_MOTOR_IN2_PIN_ID, LOGIC_LOW);
+		DcMotor_writeInputs(motor, LOGIC_HIGH, LOGIC_LOW);
+		Encoder_setCountDirection(motor, ENCODER_BACKWARD);
+		break;
+	case BRAKE:
+		DcMotor_writeInputs(motor, LOGIC_HIGH, LOGIC_HIGH);
 		break;
 	}
-	/* Send the required duty cycle to the PWM driver based on the required speed value */
-	PWM_Timer0_Start(speed);
+}
+
+/*
+ * Description :
+ * Private function to set the enable duty (0 --> 255) of a channel:
+ * 1. Hardware PWM: the Timer0 compare value.
+ * 2. Software PWM: the overflow task switches the pin, a fully off or fully on enable
+ *    is written at once so a cut off or a brake does not wait for the next overflow.
+ * Nothing is written while the outputs are locked by the emergency stop.
+ */
+static void DcMotor_setDuty(uint8 motor, uint8 duty)
+{
+	const DcMotor_ChannelConfigType *config = &DcMotor_channelConfigs[motor];
+
+	g_channels[motor].current_duty = duty;
+	if(config->pwm == DC_MOTOR_PWM_OC0)
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			if(!g_dcMotorOutputsLocked)
+			{
+				PWM_Timer0_setCompareValue(duty);
+			}
+		}
+	}
+	else if(duty == 0)
+	{
+		DcMotor_writePortMasked(config->en_port, 0, (1<<config->en_pin));
+	}
+	else if(duty == 0xFF)
+	{
+		DcMotor_writePortMasked(config->en_port, (1<<config->en_pin), 0);
+	}
+}
+
+/*
+ * Description :
+ * Private function called from the Timer0 overflow ISR: switch the software PWM enable pins,
+ * a pin is on for the first (duty + 8) / 16 overflows of the SOFT_PWM_STEPS period.
+ * It is written every overflow, so a duty change takes effect in the running period.
+ * Returns TRUE while a pin has to be switched (duty neither fully off nor fully on).
+ */
+static boolean DcMotor_softPwmTask(void)
+{
+	const DcMotor_ChannelConfigType *config;
+	uint8 phase = g_overflows & (DC_MOTOR_SOFT_PWM_STEPS - 1);
+	uint8 level;
+	uint8 motor;
+	boolean switching = FALSE;
+
+	for(motor = 0; motor < DC_MOTOR_NUM_CHANNELS; motor++)
+	{
+		config = &DcMotor_channelConfigs[motor];
+		if(config->pwm != DC_MOTOR_PWM_SOFTWARE)
+		{
+			continue;
+		}
+		level = (uint8)(((uint16)g_channels[motor].current_duty + 8) >> 4);
+		if((level == 0) || (level == DC_MOTOR_SOFT_PWM_STEPS))
+		{
+			continue;
+		}
+		switching = TRUE;
+		if(phase < level)
+		{
+			DcMotor_writePortMasked(config->en_port, (1<<config->en_pin), 0);
+		}
+		else
+		{
+			DcMotor_writePortMasked(config->en_port, 0, (1<<config->en_pin));
+		}
+	}
+	return switching;
+}
+
+/*
+ * Description :
+ * Private function to start a ramp from the current duty to the required duty,
+ * with the acceleration profile if the duty increases or the deceleration profile if not.
+ */
+static void DcMotor_startRamp(DcMotor_ChannelType *channel, uint8 duty)
+{
+	channel->ramp_from = channel->current_duty;
+	channel->ramp_to = duty;
+	channel->ramp_step = 0;
+	if(duty > channel->current_duty)
+	{
+		channel->ramp_curve = DC_MOTOR_ACCEL_CURVE;
+		channel->ramp_step_overflows = DC_MOTOR_ACCEL_STEP_OVERFLOWS;
+	}
+	else
+	{
+		channel->ramp_curve = DC_MOTOR_DECEL_CURVE;
+		channel->ramp_step_overflows = DC_MOTOR_DECEL_STEP_OVERFLOWS;
+	}
+	channel->ramp_countdown = channel->ramp_step_overflows;
+	channel->ramp_active = TRUE;
+}
+
+/*
+ * Description :
+ * Private function to plan the next ramp of a channel towards its targets:
+ * 1. If the H-bridge state must change and the motor is running, ramp down to zero first.
+ * 2. At zero duty change the H-bridge state.
+ * 3. Ramp to the target duty, or stay idle if it is reached.
+ */
+static void DcMotor_planRamp(uint8 motor)
+{
+	DcMotor_ChannelType *channel = &g_channels[motor];
+	uint8 duty = channel->target_duty;
+
+	if(channel->current_state != channel->target_state)
+	{
+		if(channel->current_duty != 0)
+		{
+			DcMotor_startRamp(channel, 0);
+			return;
+		}
+		DcMotor_setState(motor, channel->target_state);
+	}
 
+	if(channel->current_state == STOP)
+	{
+		duty = 0;
+	}
+	if(duty != channel->current_duty)
+	{
+		DcMotor_startRamp(channel, duty);
+	}
+	else
+	{
+		channel->ramp_active = FALSE;
+	}
+}
+
+/*
+ * Description :
+ * Private function called from the Timer0 overflow ISR every PWM period while a ramp is needed:
+ * 1. Plan a new ramp from the current duty if DcMotor_Rotate was called.
+ * 2. Every STEP_OVERFLOWS periods move the duty to the next point of the ramp curve,
+ *    the last point is the exact target, then plan the next ramp.
+ */
+static void DcMotor_rampTask(uint8 motor)
+{
+	DcMotor_ChannelType *channel = &g_channels[motor];
+	uint8 weight;
+	uint8 change;
+
+	if(channel->ramp_request)
+	{
+		channel->ramp_request = FALSE;
+		DcMotor_planRamp(motor);
+	}
+	if(!channel->ramp_active)
+	{
+		return;
+	}
+	if(--channel->ramp_countdown != 0)
+	{
+		return;
+	}
+	channel->ramp_countdown = channel->ramp_step_overflows;
+
+	channel->ramp_step++;
+	if(channel->ramp_step >= DC_MOTOR_RAMP_STEPS)
+	{
+		DcMotor_setDuty(motor, channel->ramp_to);
+	}
+	else
+	{
+		/* 8x8 bits hardware multiply, the fraction is weight/256 */
+		weight = pgm_read_byte(&DcMotor_curves[channel->ramp_curve][channel->ramp_step - 1]);
+		if(channel->ramp_to > channel->ramp_from)
+		{
+			change = (uint8)(((uint16)(channel->ramp_to - channel->ramp_from) * weight) >> 8);
+			DcMotor_setDuty(motor, channel->ramp_from + change);
+		}
+		else
+		{
+			change = (uint8)(((uint16)(channel->ramp_from - channel->ramp_to) * weight) >> 8);
+			DcMotor_setDuty(motor, channel->ramp_from - change);
+		}
+	}
+
+	if(channel->ramp_step >= DC_MOTOR_RAMP_STEPS)
+	{
+		DcMotor_planRamp(motor);
+	}
+}
+
+/*
+ * Description :
+ * Private function to start the requested move from the stopped motor:
+ * select the direction towards the target and reset the PI loop.
+ */
+static void DcMotor_startMove(uint8 motor)
+{
+	DcMotor_ChannelType *channel = &g_channels[motor];
+	sint32 remaining = channel->move_target - Encoder_getPosition(motor);
+
+	channel->speed_set_point = 0;
+	channel->integral = 0;
+	if(remaining > DC_MOTOR_POSITION_TOLERANCE)
+	{
+		DcMotor_setState(motor, cw);
+	}
+	else if(remaining < -DC_MOTOR_POSITION_TOLERANCE)
+	{
+		DcMotor_setState(motor, ACW);
+	}
+	else
+	{
+		/* Already there */
+		return;
+	}
+	channel->move_active = TRUE;
+}
+
+/*
+ * Description :
+ * Private function of the closed loop move, called every control period (~1 msec):
+ * 1. Stop at once when the position is within the tolerance or past the target.
+ * 2. Update the speed set-point: acceleration limit, cruise speed and the slow down
+ *    proportional to the remaining counts.
+ * 3. PI speed loop in Q8 fixed point, the output is the PWM compare value.
+ */
+static void DcMotor_positionTask(uint8 motor)
+{
+	DcMotor_ChannelType *channel = &g_channels[motor];
+	sint32 remaining = channel->move_target - Encoder_getPosition(motor);
+	sint32 error;
+	sint32 output;
+	uint16 limit;
+
+	if(channel->current_state == ACW)
+	{
+		remaining = -remaining;
+	}
+	if(remaining <= DC_MOTOR_POSITION_TOLERANCE)
+	{
+		/* A deceleration ramp would overtravel, the PI loop already arrives at creep speed */
+		DcMotor_setDuty(motor, 0);
+		DcMotor_setState(motor, STOP);
+		channel->move_active = FALSE;
+		return;
+	}
+
+	if(channel->speed_set_point < (DC_MOTOR_CRUISE_SPEED - DC_MOTOR_ACCEL_STEP))
+	{
+		channel->speed_set_point += DC_MOTOR_ACCEL_STEP;
+	}
+	else
+	{
+		channel->speed_set_point = DC_MOTOR_CRUISE_SPEED;
+	}
+	if(remaining < (DC_MOTOR_CRUISE_SPEED / DC_MOTOR_POSITION_GAIN))
+	{
+		limit = (uint16)remaining * DC_MOTOR_POSITION_GAIN;
+		if(limit < DC_MOTOR_CREEP_SPEED)
+		{
+			limit = DC_MOTOR_CREEP_SPEED;
+		}
+		if(channel->speed_set_point > limit)
+		{
+			channel->speed_set_point = limit;
+		}
+	}
+
+	error = (sint32)channel->speed_set_point - (sint32)Encoder_getSpeed(motor);
+	channel->integral += DC_MOTOR_KI_Q8 * error;
+	if(channel->integral > DC_MOTOR_INTEGRAL_MAX)
+	{
+		channel->integral = DC_MOTOR_INTEGRAL_MAX;
+	}
+	else if(channel->integral < 0)
+	{
+		channel->integral = 0;
+	}
+	output = ((DC_MOTOR_KP_Q8 * error) + channel->integral) / 256;
+	if(output > 255)
+	{
+		output = 255;
+	}
+	else if(output < 0)
+	{
+		output = 0;
+	}
+	DcMotor_setDuty(motor, (uint8)output);
+}
+
+/*
+ * Description :
+ * Private function to run the ramp or the move of one channel, returns FALSE if it is idle:
+ * 1. Ramps of DcMotor_Rotate first, they also stop an open loop rotation before a move.
+ * 2. Start a requested move, then run its PI loop in the channel slot of the
+ *    CONTROL_OVERFLOWS periods.
+ */
+static boolean DcMotor_channelTask(uint8 motor)
+{
+	DcMotor_ChannelType *channel = &g_channels[motor];
+
+	if(channel->ramp_request || channel->ramp_active)
+	{
+		DcMotor_rampTask(motor);
+	}
+	else if(channel->move_request)
+	{
+		channel->move_request = FALSE;
+		DcMotor_startMove(motor);
+	}
+	else if(channel->move_active)
+	{
+		if((g_overflows % DC_MOTOR_CONTROL_OVERFLOWS) == (motor % DC_MOTOR_CONTROL_OVERFLOWS))
+		{
+			DcMotor_positionTask(motor);
+		}
+	}
+	else
+	{
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Private function called from the Timer0 overflow ISR every PWM period:
+ * 1. Ramp or move of every channel.
+ * 2. Software PWM enable pins.
+ * 3. Disable the callback when there is nothing to do.
+ * The ISR runs it with the interrupts enabled, so it does not delay an emergency stop brake.
+ */
+static void DcMotor_timerTask(void)
+{
+	boolean busy = FALSE;
+	uint8 motor;
+
+	g_overflows++;
+	for(motor = 0; motor < DC_MOTOR_NUM_CHANNELS; motor++)
+	{
+		if(DcMotor_channelTask(motor))
+		{
+			busy = TRUE;
+		}
+	}
+	if(DcMotor_softPwmTask())
+	{
+		busy = TRUE;
+	}
+	if(!busy)
+	{
+		/* Nothing to do until the next DcMotor_Rotate or DcMotor_moveTo call */
+		PWM_Timer0_enableCallBack(FALSE);
+	}
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * The Function responsible for setup the direction for the motor pins of every channel
+ * through the GPIO driver.
+ * */
+void DcMotor_init(void)
+{
+	/* Motor PWM: Fast PWM 3.9 KHz, the ramp timing in dc_motor.h is based on its 256 usec period */
+	const PWM_Timer0_ConfigType pwmConfig = { PWM_TIMER0_FAST_MODE, PWM_TIMER0_PRESCALER_8 };
+	const DcMotor_ChannelConfigType *config;
+	uint8 motor;
+
+	for(motor = 0; motor < DC_MOTOR_NUM_CHANNELS; motor++)
+	{
+		config = &DcMotor_channelConfigs[motor];
+		GPIO_setupPinDirection(config->in1_port, config->in1_pin, PIN_OUTPUT);
+		GPIO_setupPinDirection(config->in2_port, config->in2_pin, PIN_OUTPUT);
+		/* Stop the DC-Motor at the beginning through the GPIO driver */
+		DcMotor_writeInputs(motor, LOGIC_LOW, LOGIC_LOW);
+		if(config->pwm == DC_MOTOR_PWM_SOFTWARE)
+		{
+			GPIO_writePin(config->en_port, config->en_pin, LOGIC_LOW);
+			GPIO_setupPinDirection(config->en_port, config->en_pin, PIN_OUTPUT);
+		}
+	}
+	/* Start the PWM at zero duty, the ramps and the PI loops run from the Timer0 overflow ISR */
+	PWM_Timer0_init(&pwmConfig);
+	PWM_Timer0_setCallBack(DcMotor_timerTask);
+}
+
+/*
+ * Description :
+ * The function responsible for rotate the required DC Motor channel CW/ or A-CW or stop
+ * the motor based on the state input state value.
+ * The motor ramps to the required speed along the acceleration/deceleration curves,
+ * a direction change or a stop ramps down to zero first. The function returns at once.
+ */
+void DcMotor_Rotate(uint8 motor, DcMotor_State state, uint8 speed)
+{
+	DcMotor_ChannelType *channel = &g_channels[motor];
+
+	if(speed > 100)
+	{
+		speed = 100;
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		channel->target_state = state;
+		channel->target_duty = (uint8)(((uint16)speed * 255) / 100);
+		channel->ramp_request = TRUE;
+		/* Cancel a closed loop move, the ramp continues from its duty */
+		channel->move_request = FALSE;
+		channel->move_active = FALSE;
+		PWM_Timer0_enableCallBack(TRUE);
+	}
+}
+
+/*
+ * Description :
+ * Return TRUE when the motor reached the state and speed of the last DcMotor_Rotate call.
+ */
+boolean DcMotor_isRampDone(uint8 motor)
+{
+	return (!g_channels[motor].ramp_request) && (!g_channels[motor].ramp_active);
+}
+
+/*
+ * Description :
+ * Move the motor to the required encoder position with the PI speed loop.
+ * A running open loop rotation ramps down to zero first, the move starts from the stopped motor.
+ */
+void DcMotor_moveTo(uint8 motor, sint32 position)
+{
+	DcMotor_ChannelType *channel = &g_channels[motor];
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		channel->move_target = position;
+		channel->move_active = FALSE;
+		channel->move_request = TRUE;
+		channel->target_state = STOP;
+		channel->target_duty = 0;
+		channel->ramp_request = TRUE;
+		PWM_Timer0_enableCallBack(TRUE);
+	}
+}
+
+/*
+ * Description :
+ * Return TRUE when the last DcMotor_moveTo reached its position (or was cancelled).
+ */
+boolean DcMotor_isMoveDone(uint8 motor)
+{
+	return (!g_channels[motor].move_request) && (!g_channels[motor].move_active);
+}
+
+/*
+ * Description :
+ * Stop driving the motor at once without the deceleration ramp, the running ramp or move is cancelled.
+ */
+void DcMotor_cutOff(uint8 motor)
+{
+	DcMotor_ChannelType *channel = &g_channels[motor];
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		channel->target_state = STOP;
+		channel->target_duty = 0;
+		channel->ramp_request = FALSE;
+		channel->ramp_active = FALSE;
+		channel->move_request = FALSE;
+		channel->move_active = FALSE;
+		DcMotor_setDuty(motor, 0);
+		DcMotor_setState(motor, STOP);
+	}
+}
+
+/*
+ * Description :
+ * Brake the motor at once, the running ramp or move is cancelled.
+ * The enable is fully on so the brake is not chopped, the H-bridge shorts the motor.
+ * The Timer0 callback is left to the other channels, it stops by itself when they are idle.
+ * The motor outputs locked by the emergency stop are unlocked: the Timer0 callback is disabled
+ * by the brake ISR, and it is enabled again only by a new move or rotation.
+ */
+void DcMotor_brake(uint8 motor)
+{
+	DcMotor_ChannelType *channel = &g_channels[motor];
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		channel->target_state = BRAKE;
+		channel->target_duty = 0xFF;
+		channel->ramp_request = FALSE;
+		channel->ramp_active = FALSE;
+		channel->move_request = FALSE;
+		channel->move_active = FALSE;
+		g_dcMotorOutputsLocked = FALSE;
+		DcMotor_setDuty(motor, 0xFF);
+		DcMotor_setState(motor, BRAKE);
+	}
 }
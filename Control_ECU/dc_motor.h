@@ -17,20 +17,81 @@
 /*******************************************************************************
  *                                Definitions                                  *
  *******************************************************************************/
-#define DC_MOTOR_IN1_PORT_ID 				PORTB_ID
-#define DC_MOTOR_IN1_PIN_ID            	    PIN0_ID
+/*
+ * Motor channels, one H-bridge per door (1 --> 2 channels, see the encoder channels).
+ * Channel 0 enable is the Timer0 OC0 hardware PWM (PB3). Timer2 OC2 is kept for the buzzer
+ * and Timer1 runs the system tick, so the enable of channel 1 is a software PWM pin.
+ */
+#define DC_MOTOR_NUM_CHANNELS               2
+
+#define DC_MOTOR0_IN1_PORT_ID               PORTB_ID
+#define DC_MOTOR0_IN1_PIN_ID                PIN0_ID
+#define DC_MOTOR0_IN2_PORT_ID               PORTB_ID
+#define DC_MOTOR0_IN2_PIN_ID                PIN1_ID
+
+#if (DC_MOTOR_NUM_CHANNELS > 1)
+#define DC_MOTOR1_IN1_PORT_ID               PORTB_ID
+#define DC_MOTOR1_IN1_PIN_ID                PIN4_ID
+#define DC_MOTOR1_IN2_PORT_ID               PORTB_ID
+#define DC_MOTOR1_IN2_PIN_ID                PIN5_ID
+#define DC_MOTOR1_EN_PORT_ID                PORTB_ID
+#define DC_MOTOR1_EN_PIN_ID                 PIN6_ID
+#endif
+
+/*
+ * Software PWM: the enable pin is switched from the Timer0 overflow interrupt, one period is
+ * SOFT_PWM_STEPS overflows: 16 * 256usec = 4.1 msec (244 Hz) with 16 duty levels.
+ * The PI loop integral smooths the coarser duty steps.
+ */
+#define DC_MOTOR_SOFT_PWM_STEPS             16
+
+/*
+ * Soft-start/soft-stop ramps, stepped from the Timer0 overflow interrupt (every 256 usec).
+ * A ramp goes through DC_MOTOR_RAMP_STEPS points of its flash curve, one point every
+ * STEP_OVERFLOWS overflows: 32 * 12 * 256usec = 98 msec to accelerate from 0 to 100%,
+ * 32 * 8 * 256usec = 66 msec to decelerate from 100% to 0.
+ */
+#define DC_MOTOR_RAMP_STEPS                 32
+#define DC_MOTOR_ACCEL_CURVE                DC_MOTOR_CURVE_S
+#define DC_MOTOR_ACCEL_STEP_OVERFLOWS       12
+#define DC_MOTOR_DECEL_CURVE                DC_MOTOR_CURVE_S
+#define DC_MOTOR_DECEL_STEP_OVERFLOWS       8
 
-#define DC_MOTOR_IN2_PORT_ID				PORTB_ID
-#define DC_MOTOR_IN2_PIN_ID            	    PIN1_ID
+/*
+ * Closed loop moves to an encoder position, run from the same Timer0 overflow interrupt.
+ * The PI speed loop runs every CONTROL_OVERFLOWS overflows: 4 * 256usec = 1.024 msec (~1 KHz),
+ * each channel in its own overflow so the channels loops never run in the same ISR.
+ * Speed set-point in encoder counts/sec: it rises by ACCEL_STEP every control period
+ * (0 --> 1200 counts/sec in 600 msec) up to CRUISE_SPEED, near the target it is limited to
+ * POSITION_GAIN * remaining counts (from 300 counts before the target) but not below CREEP_SPEED.
+ * The motor stops when the position is within POSITION_TOLERANCE counts of the target or past it.
+ */
+#define DC_MOTOR_CONTROL_OVERFLOWS          4
+#define DC_MOTOR_CRUISE_SPEED               1200
+#define DC_MOTOR_CREEP_SPEED                150
+#define DC_MOTOR_ACCEL_STEP                 2
+#define DC_MOTOR_POSITION_GAIN              4
+#define DC_MOTOR_POSITION_TOLERANCE         2
+
+/* PI gains in Q8 fixed point: duty (0 --> 255) = (KP * error + KI * sum of errors) / 256 */
+#define DC_MOTOR_KP_Q8                      32
+#define DC_MOTOR_KI_Q8                      2
+/* The integral term is clamped to the duty range so it can not wind up */
+#define DC_MOTOR_INTEGRAL_MAX               (255L * 256)
 
 /*******************************************************************************
  *                         Types Declaration                                   *
  *******************************************************************************/
 
 typedef enum {
-	STOP,cw,ACW
+	STOP,cw,ACW,BRAKE
 }DcMotor_State;
 
+/* Ramp curves shapes, the curves points are stored in flash */
+typedef enum {
+	DC_MOTOR_CURVE_LINEAR, DC_MOTOR_CURVE_S, DC_MOTOR_NUM_CURVES
+}DcMotor_RampCurve;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
@@ -38,16 +99,74 @@ typedef enum {
 /*
  * Description :
  * The Function responsible for setup the direction
- * for the two motor pins through the GPIO driver.
- * Stop at the DC-Motor at the beginning through the GPIO driver.
+ * for the motor pins of every channel through the GPIO driver.
+ * Stop at the DC-Motors at the beginning through the GPIO driver.
  * */
 void DcMotor_init(void);
 
 /*
  * Description :
- * The function responsible for rotate the DC Motor CW/ or A-CW or stop
+ * The function responsible for rotate the required DC Motor channel CW/ or A-CW or stop
  * the motor based on the state input state value.
- * Send the required duty cycle to the PWM driver based on the required speed value.
+ * The motor ramps to the required speed along the acceleration/deceleration curves,
+ * a direction change or a stop ramps down to zero first. The function returns at once.
+ */
+void DcMotor_Rotate(uint8 motor, DcMotor_State state, uint8 speed);
+
+/*
+ * Description :
+ * Return TRUE when the motor reached the state and speed of the last DcMotor_Rotate call.
+ */
+boolean DcMotor_isRampDone(uint8 motor);
+
+/*
+ * Description :
+ * Move the motor to the required encoder position with the PI speed loop, CW towards
+ * higher positions. A running open loop rotation ramps down first. The function returns at once,
+ * a DcMotor_Rotate call cancels the move.
+ */
+void DcMotor_moveTo(uint8 motor, sint32 position);
+
+/*
+ * Description :
+ * Return TRUE when the last DcMotor_moveTo reached its position (or was cancelled).
+ */
+boolean DcMotor_isMoveDone(uint8 motor);
+
+/*
+ * Description :
+ * Stop driving the motor at once (zero duty, IN1 = IN2 = 0) without the deceleration ramp,
+ * the running ramp or move is cancelled. Used when the motor is stalled.
+ */
+void DcMotor_cutOff(uint8 motor);
+
+/*
+ * Description :
+ * Brake the motor at once: IN1 = IN2 = 1 with the enable fully on, the motor terminals are
+ * shorted by the H-bridge. The running ramp or move is cancelled, the other channels keep running.
+ * It also unlocks the motor outputs after DcMotor_lockOutputsInline.
+ */
+void DcMotor_brake(uint8 motor);
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+/* The motor outputs are locked by the emergency stop, use DcMotor_lockOutputsInline to set it */
+extern volatile boolean g_dcMotorOutputsLocked;
+
+/*******************************************************************************
+ *                              Inline Functions                               *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Lock the motor outputs, called by the emergency stop ISRs after they braked the H-bridges:
+ * the Timer0 motor task runs with the interrupts enabled, if it was interrupted by the brake
+ * its next writes to the H-bridge inputs, the enables and OCR0 are dropped and can not release
+ * the brake. DcMotor_brake unlocks the outputs.
  */
-void DcMotor_Rotate(DcMotor_State state, uint8 speed);
+static inline __attribute__((always_inline)) void DcMotor_lockOutputsInline(void)
+{
+	g_dcMotorOutputsLocked = TRUE;
+}
 #endif /* DC_MOTOR_H_ */
@@ -0,0 +1,302 @@
+ /******************************************************************************
+ *
+ * Module: Encoder
+ *
+ * File Name: encoder.c
+ *
+ * Description: Source file for the door motors encoders driver (Timer1 input capture and INT2)
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+#include "encoder.h"
+#include "timer1.h"
+#include "work_queue.h"
+#include "common_macros.h"
+#include <avr/io.h> /* To use the Timer1 capture and compare match flag and the INT2 Registers */
+#include <avr/interrupt.h> /* For Timer1 input capture and INT2 ISRs */
+#include <util/atomic.h> /* To read the multi-byte values updated by the edge ISRs */
+
+/*******************************************************************************
+ *                         Types Declaration (Private)                         *
+ *******************************************************************************/
+/* Counting and timing state of an encoder channel */
+typedef struct {
+	/* Position in counts, forward counts are positive */
+	volatile sint32 position;
+	/* Time between the last two edges in Timer1 counts (usec), zero when the motor is stopped */
+	volatile uint16 period;
+	/* Counting direction of a single channel encoder */
+	volatile Encoder_DirectionType count_direction;
+
+	/* Timer1 tick and count of the last edge */
+	uint16 last_tick;
+	uint16 last_capture;
+	/* The last edge is less than ENCODER_STOP_TIMEOUT_TICKS old, the next period is measured from it */
+	volatile boolean edge_valid;
+
+	/* Speed of the last period, calculated by the work item the edge ISR posts */
+	volatile uint16 speed;
+	/* The speed work item of the channel is in the work queue */
+	volatile boolean speed_posted;
+}Encoder_ChannelType;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+static Encoder_ChannelType g_channels[ENCODER_NUM_CHANNELS];
+
+/*******************************************************************************
+ *                      Functions Definitions (Private)                        *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Private function to return the system tick of a Timer1 count, called from the edge ISRs.
+ * If the compare match flag is still pending and the count is at the start of the tick,
+ * the tick ISR did not count the new tick yet, so count it here.
+ */
+static inline __attribute__((always_inline)) uint16 Encoder_getTick(uint16 capture)
+{
+	uint16 tick = Timer1_getTicksInline();
+
+	if(BIT_IS_SET(TIFR,OCF1A) && (capture < (ENCODER_TIMER_COUNTS_PER_TICK / 2)))
+	{
+		tick++;
+	}
+	return tick;
+}
+
+/*
+ * Description :
+ * Private work item posted by the edge ISRs, run in the main context:
+ * the speed in counts/sec = 1000000 / period in usec of the last measured period,
+ * so the 32-bit division is done neither in the edge ISRs nor in the motor control task.
+ */
+static void Encoder_speedTask(uint8 channel_num)
+{
+	Encoder_ChannelType *channel = &g_channels[channel_num];
+	uint16 period;
+	uint16 speed;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		/* A period measured from now on posts the work item again */
+		period = channel->period;
+		channel->speed_posted = FALSE;
+	}
+	if(period == 0)
+	{
+		speed = 0;
+	}
+	else if(period <= (ENCODER_ONE_SECOND_US / 0xFFFF))
+	{
+		speed = 0xFFFF;
+	}
+	else
+	{
+		speed = (uint16)(ENCODER_ONE_SECOND_US / period);
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		channel->speed = speed;
+	}
+}
+
+/*
+ * Description :
+ * Private function inlined in the edge ISRs on every channel A rising edge, so the ISRs make no call:
+ * 1. Count the edge in the direction of channel B (or the motor direction).
+ * 2. Measure the period from the last edge: the whole system ticks between the two edges
+ *    plus the difference of the two Timer1 counts.
+ * 3. Post the speed work item of the channel, unless it is still in the queue: it reads
+ *    the last period when it runs, so the queue holds one item per channel at most.
+ */
+static inline __attribute__((always_inline)) void Encoder_edgeTask(uint8 channel_num, uint16 capture, uint8 b_value)
+{
+	Encoder_ChannelType *channel = &g_channels[channel_num];
+	uint16 tick = Encoder_getTick(capture);
+	uint16 ticks = tick - channel->last_tick;
+	Encoder_DirectionType direction;
+
+#if (ENCODER_QUADRATURE == TRUE)
+	if(b_value == LOGIC_LOW)
+	{
+		direction = ENCODER_FORWARD;
+	}
+	else
+	{
+		direction = ENCODER_BACKWARD;
+	}
+#else
+	(void)b_value;
+	direction = channel->count_direction;
+#endif
+	if(direction == ENCODER_FORWARD)
+	{
+		channel->position++;
+	}
+	else
+	{
+		channel->position--;
+	}
+
+	if(channel->edge_valid && (ticks < ENCODER_STOP_TIMEOUT_TICKS))
+	{
+		channel->period = (uint16)((ticks * ENCODER_TIMER_COUNTS_PER_TICK) + capture - channel->last_capture);
+	}
+	else
+	{
+		/* First edge after a stop, the period is known from the next edge */
+		channel->period = 0;
+	}
+	channel->last_tick = tick;
+	channel->last_capture = capture;
+	channel->edge_valid = TRUE;
+	if(!channel->speed_posted)
+	{
+		channel->speed_posted = WorkQueue_postInline(Encoder_speedTask, channel_num);
+	}
+}
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+/* Timer1 Input Capture ISR, channel 0 edge: the time stamp is the count captured in ICR1 */
+ISR(TIMER1_CAPT_vect)
+{
+#if (ENCODER_QUADRATURE == TRUE)
+	Encoder_edgeTask(0, ICR1, GPIO_readPinInline(ENCODER0_B_PORT_ID,ENCODER0_B_PIN_ID));
+#else
+	Encoder_edgeTask(0, ICR1, LOGIC_LOW);
+#endif
+}
+
+#if (ENCODER_NUM_CHANNELS > 1)
+/* External Interrupt 2 ISR, channel 1 edge: the Timer1 count is read first */
+ISR(INT2_vect)
+{
+	uint16 capture = TCNT1;
+
+#if (ENCODER_QUADRATURE == TRUE)
+	Encoder_edgeTask(1, capture, GPIO_readPinInline(ENCODER1_B_PORT_ID,ENCODER1_B_PIN_ID));
+#else
+	Encoder_edgeTask(1, capture, LOGIC_LOW);
+#endif
+}
+#endif
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the encoder driver:
+ * 1. No valid last edge on every channel (zero initialized).
+ * 2. Setup the channels B pins as inputs (quadrature only).
+ * 3. Enable the Timer1 input capture on the rising edge of channel 0 A.
+ * 4. Enable INT2 on the rising edge of channel 1 A (ISC2 = 1), its flag is cleared
+ *    after the edge selection to avoid a false interrupt.
+ */
+void Encoder_init(void)
+{
+#if (ENCODER_QUADRATURE == TRUE)
+	GPIO_setupPinDirectionInline(ENCODER0_B_PORT_ID,ENCODER0_B_PIN_ID,PIN_INPUT);
+#endif
+	Timer1_enableInputCapture(CAPTURE_RISING_EDGE);
+
+#if (ENCODER_NUM_CHANNELS > 1)
+#if (ENCODER_QUADRATURE == TRUE)
+	GPIO_setupPinDirectionInline(ENCODER1_B_PORT_ID,ENCODER1_B_PIN_ID,PIN_INPUT);
+#endif
+	GPIO_setupPinDirectionInline(ENCODER1_A_PORT_ID,ENCODER1_A_PIN_ID,PIN_INPUT);
+	MCUCSR |= (1<<ISC2);
+	GIFR = (1<<INTF2);
+	GICR |= (1<<INT2);
+#endif
+}
+
+/*
+ * Description :
+ * Called every system tick (1 msec) from the main context: the last edge of a channel
+ * older than ENCODER_STOP_TIMEOUT_TICKS is no longer valid, its motor is stopped.
+ * It keeps an old edge from looking recent again when the 16-bit tick count wraps.
+ */
+void Encoder_tickTask(void)
+{
+	Encoder_ChannelType *channel;
+	uint8 channel_num;
+
+	for(channel_num = 0; channel_num < ENCODER_NUM_CHANNELS; channel_num++)
+	{
+		channel = &g_channels[channel_num];
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			if(channel->edge_valid &&
+					((uint16)(Timer1_getTicks() - channel->last_tick) >= ENCODER_STOP_TIMEOUT_TICKS))
+			{
+				channel->edge_valid = FALSE;
+				channel->period = 0;
+			}
+		}
+	}
+}
+
+/*
+ * Description :
+ * Set the counting direction of a single channel encoder, it is ignored for a quadrature one.
+ */
+void Encoder_setCountDirection(uint8 channel, Encoder_DirectionType direction)
+{
+	g_channels[channel].count_direction = direction;
+}
+
+/*
+ * Description :
+ * Return the position in counts, forward counts are positive.
+ */
+sint32 Encoder_getPosition(uint8 channel)
+{
+	sint32 position;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		position = g_channels[channel].position;
+	}
+	return position;
+}
+
+/*
+ * Description :
+ * Set the current position in counts.
+ */
+void Encoder_setPosition(uint8 channel, sint32 position)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		g_channels[channel].position = position;
+	}
+}
+
+/*
+ * Description :
+ * Return the speed magnitude in counts/sec of the last period, zero if the motor is stopped
+ * (no edge for ENCODER_STOP_TIMEOUT_TICKS, checked here too as the tick task may run late).
+ * No division here, it is done by the speed work item.
+ */
+uint16 Encoder_getSpeed(uint8 channel_num)
+{
+	Encoder_ChannelType *channel = &g_channels[channel_num];
+	uint16 speed;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		speed = channel->speed;
+		if((uint16)(Timer1_getTicks() - channel->last_tick) >= ENCODER_STOP_TIMEOUT_TICKS)
+		{
+			speed = 0;
+		}
+	}
+	return speed;
+}
@@ -0,0 +1,112 @@
+ /******************************************************************************
+ *
+ * Module: Encoder
+ *
+ * File Name: encoder.h
+ *
+ * Description: Header file for the door motors encoders driver (Timer1 input capture and INT2)
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+
+#ifndef ENCODER_H_
+#define ENCODER_H_
+
+#include "std_types.h"
+#include "gpio.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+/*
+ * One encoder channel per door motor (1 --> 2 channels), every rising edge of A is one count:
+ * channel 0 A is wired to ICP1 (PD6), the edge time is captured by Timer1.
+ * channel 1 A is wired to INT2 (PB2), the edge time is the Timer1 count read by the INT2 ISR,
+ * late by the interrupt response (~3 usec, or a running ISR), below 1% of the cruise period.
+ * With a quadrature encoder channel B gives the direction: B low on the A rising edge
+ * is the forward (motor CW, door unlocking) direction.
+ * With single channel encoders set ENCODER_QUADRATURE to FALSE,
+ * the counting direction is then the one set by the motor driver.
+ */
+#define ENCODER_NUM_CHANNELS            2
+#define ENCODER_QUADRATURE              TRUE
+
+#if (ENCODER_QUADRATURE == TRUE)
+#define ENCODER0_B_PORT_ID              PORTC_ID
+#define ENCODER0_B_PIN_ID               PIN3_ID
+#define ENCODER1_B_PORT_ID              PORTC_ID
+#define ENCODER1_B_PIN_ID               PIN4_ID
+#endif
+
+#if (ENCODER_NUM_CHANNELS > 1)
+#define ENCODER1_A_PORT_ID              PORTB_ID
+#define ENCODER1_A_PIN_ID               PIN2_ID
+#endif
+
+/*
+ * Capture time base: Timer1 system tick with F_CPU/8
+ * One Timer1 count = 1usec and one system tick = 1000 counts = 1 msec
+ */
+#define ENCODER_TIMER_COUNTS_PER_TICK   1000
+#define ENCODER_ONE_SECOND_US           1000000UL
+
+/*
+ * No edge for this number of system ticks (Timer1_getTicks) means the motor is stopped, it is below 65 ticks
+ * so an edge period always fits 16 bits. Slowest measured speed = 1000 / 50 = 20 counts/sec.
+ */
+#define ENCODER_STOP_TIMEOUT_TICKS      50
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+typedef enum {
+	ENCODER_FORWARD, ENCODER_BACKWARD
+}Encoder_DirectionType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the encoder driver:
+ * 1. Setup the channels B pins as inputs (quadrature only).
+ * 2. Enable the Timer1 input capture and INT2 on the rising edge of the channels A.
+ * Timer1 must already run the system tick with F_CPU/8.
+ */
+void Encoder_init(void);
+
+/*
+ * Description :
+ * Called every system tick (1 msec) from the main context, it detects the stopped motor.
+ */
+void Encoder_tickTask(void);
+
+/*
+ * Description :
+ * Set the counting direction of a single channel encoder, it is ignored for a quadrature one.
+ */
+void Encoder_setCountDirection(uint8 channel, Encoder_DirectionType direction);
+
+/*
+ * Description :
+ * Return the position in counts, forward counts are positive.
+ */
+sint32 Encoder_getPosition(uint8 channel);
+
+/*
+ * Description :
+ * Set the current position in counts (e.g. zero at the locked position).
+ */
+void Encoder_setPosition(uint8 channel, sint32 position);
+
+/*
+ * Description :
+ * Return the speed magnitude in counts/sec from the period of the last two edges,
+ * zero if the motor is stopped. The speed is calculated in the main context by the work item
+ * the edge ISR posts to the work queue, it is as old as the last run of WorkQueue_runPending.
+ */
+uint16 Encoder_getSpeed(uint8 channel);
+
+#endif /* ENCODER_H_ */
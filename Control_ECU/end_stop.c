@@ -0,0 +1,116 @@
+ /******************************************************************************
+ *
+ * Module: End Stop
+ *
+ * File Name: end_stop.c
+ *
+ * Description: Source file for the doors bolts end-stop switches driver
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+#include "end_stop.h"
+#include "timer1.h"
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+#if (END_STOP_ENABLE == TRUE)
+/* Number of ticks each switch read closed in a row, saturated at END_STOP_DEBOUNCE_MS */
+static volatile uint8 g_closedTicks[END_STOP_NUM_DOORS][END_STOP_NUM];
+/* Timer1 tick count of the last switches reading, every tick count is read once */
+static uint16 g_lastTick = 0;
+#endif
+
+/*******************************************************************************
+ *                      Functions Definitions (Private)                        *
+ *******************************************************************************/
+#if (END_STOP_ENABLE == TRUE)
+/*
+ * Description :
+ * Private function to count the ticks a switch read closed, a single open read restarts the count.
+ */
+static void EndStop_debounce(uint8 door, EndStop_IdType id, uint8 value)
+{
+	if(value == LOGIC_LOW)
+	{
+		if(g_closedTicks[door][id] < END_STOP_DEBOUNCE_MS)
+		{
+			g_closedTicks[door][id]++;
+		}
+	}
+	else
+	{
+		g_closedTicks[door][id] = 0;
+	}
+}
+#endif
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Setup the switches pins as inputs with the internal pull-ups.
+ */
+void EndStop_init(void)
+{
+#if (END_STOP_ENABLE == TRUE)
+	GPIO_setupPinDirectionInline(END_STOP0_UNLOCKED_PORT_ID,END_STOP0_UNLOCKED_PIN_ID,PIN_INPUT);
+	GPIO_writePinInline(END_STOP0_UNLOCKED_PORT_ID,END_STOP0_UNLOCKED_PIN_ID,LOGIC_HIGH);
+	GPIO_setupPinDirectionInline(END_STOP0_LOCKED_PORT_ID,END_STOP0_LOCKED_PIN_ID,PIN_INPUT);
+	GPIO_writePinInline(END_STOP0_LOCKED_PORT_ID,END_STOP0_LOCKED_PIN_ID,LOGIC_HIGH);
+#if (END_STOP_NUM_DOORS > 1)
+	GPIO_setupPinDirectionInline(END_STOP1_UNLOCKED_PORT_ID,END_STOP1_UNLOCKED_PIN_ID,PIN_INPUT);
+	GPIO_writePinInline(END_STOP1_UNLOCKED_PORT_ID,END_STOP1_UNLOCKED_PIN_ID,LOGIC_HIGH);
+	GPIO_setupPinDirectionInline(END_STOP1_LOCKED_PORT_ID,END_STOP1_LOCKED_PIN_ID,PIN_INPUT);
+	GPIO_writePinInline(END_STOP1_LOCKED_PORT_ID,END_STOP1_LOCKED_PIN_ID,LOGIC_HIGH);
+#endif
+#endif
+}
+
+/*
+ * Description :
+ * Called every system tick (1 msec): read and debounce the switches.
+ * The ticks counted while the main context was busy are run back to back with the same Timer1
+ * tick count, only the first of them reads the switches, so one reading is never counted as many ms.
+ */
+void EndStop_tickTask(void)
+{
+#if (END_STOP_ENABLE == TRUE)
+	uint16 tick = Timer1_getTicks();
+
+	if(tick == g_lastTick)
+	{
+		return;
+	}
+	g_lastTick = tick;
+	EndStop_debounce(0, END_STOP_UNLOCKED,
+			GPIO_readPinInline(END_STOP0_UNLOCKED_PORT_ID,END_STOP0_UNLOCKED_PIN_ID));
+	EndStop_debounce(0, END_STOP_LOCKED,
+			GPIO_readPinInline(END_STOP0_LOCKED_PORT_ID,END_STOP0_LOCKED_PIN_ID));
+#if (END_STOP_NUM_DOORS > 1)
+	EndStop_debounce(1, END_STOP_UNLOCKED,
+			GPIO_readPinInline(END_STOP1_UNLOCKED_PORT_ID,END_STOP1_UNLOCKED_PIN_ID));
+	EndStop_debounce(1, END_STOP_LOCKED,
+			GPIO_readPinInline(END_STOP1_LOCKED_PORT_ID,END_STOP1_LOCKED_PIN_ID));
+#endif
+#endif
+}
+
+/*
+ * Description :
+ * Return TRUE if the required switch of the required door is closed (debounced),
+ * always FALSE without switches.
+ */
+boolean EndStop_isActive(uint8 door, EndStop_IdType id)
+{
+#if (END_STOP_ENABLE == TRUE)
+	return (g_closedTicks[door][id] >= END_STOP_DEBOUNCE_MS);
+#else
+	(void)door;
+	(void)id;
+	return FALSE;
+#endif
+}
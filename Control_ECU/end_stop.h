@@ -0,0 +1,74 @@
+ /******************************************************************************
+ *
+ * Module: End Stop
+ *
+ * File Name: end_stop.h
+ *
+ * Description: Header file for the doors bolts end-stop switches driver
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+
+#ifndef END_STOP_H_
+#define END_STOP_H_
+
+#include "std_types.h"
+#include "gpio.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+/* Set to FALSE if the door has no end-stop switches, the switches are then never active */
+#define END_STOP_ENABLE                 TRUE
+
+/*
+ * Two switches per door (1 --> 2 doors), to ground with the internal pull-ups,
+ * closed (LOW) when the bolt is at the end: door 0 on PA1 (unlocked) and PA2 (locked),
+ * door 1 on PA4 (unlocked) and PA5 (locked).
+ */
+#define END_STOP_NUM_DOORS              2
+
+#define END_STOP0_UNLOCKED_PORT_ID      PORTA_ID
+#define END_STOP0_UNLOCKED_PIN_ID       PIN1_ID
+#define END_STOP0_LOCKED_PORT_ID        PORTA_ID
+#define END_STOP0_LOCKED_PIN_ID         PIN2_ID
+
+#define END_STOP1_UNLOCKED_PORT_ID      PORTA_ID
+#define END_STOP1_UNLOCKED_PIN_ID       PIN4_ID
+#define END_STOP1_LOCKED_PORT_ID        PORTA_ID
+#define END_STOP1_LOCKED_PIN_ID         PIN5_ID
+
+/* A switch is active after it reads closed for this number of system ticks (ms) in a row */
+#define END_STOP_DEBOUNCE_MS            3
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+typedef enum {
+	END_STOP_UNLOCKED, END_STOP_LOCKED, END_STOP_NUM
+}EndStop_IdType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Setup the switches pins as inputs with the internal pull-ups.
+ */
+void EndStop_init(void);
+
+/*
+ * Description :
+ * Called every system tick (1 msec): read and debounce the switches, once per Timer1 tick count.
+ */
+void EndStop_tickTask(void);
+
+/*
+ * Description :
+ * Return TRUE if the required switch of the required door is closed (debounced).
+ */
+boolean EndStop_isActive(uint8 door, EndStop_IdType id);
+
+#endif /* END_STOP_H_ */
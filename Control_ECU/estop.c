@@ -0,0 +1,164 @@
+ /******************************************************************************
+ *
+ * Module: Emergency Stop
+ *
+ * File Name: estop.c
+ *
+ * Description: Source file for the obstruction and emergency stop inputs driver
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+#include "estop.h"
+#include "dc_motor.h"
+#include "Timer0_pwm.h"
+#include "work_queue.h"
+#include "common_macros.h"
+#include <avr/io.h> /* To use the External Interrupts Registers */
+#include <avr/interrupt.h> /* For INT0 and INT1 ISRs */
+#include <util/atomic.h> /* To take the event set by the ISRs */
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+/* Last event, set by the ISRs and cleared by the sequencer */
+static volatile EStop_EventType g_event = ESTOP_NONE;
+/* Work item posted by the ISRs for the sequencer, and TRUE while it is in the queue */
+static WorkQueue_HandlerType volatile g_callBackPtr = NULL_PTR;
+static volatile boolean g_eventPosted = FALSE;
+/* Number of brakes since reset, saturated at 255 */
+static volatile uint8 g_events = 0;
+
+/*******************************************************************************
+ *                      Functions Definitions (Private)                        *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Brake all the motors from the ISRs before anything else, with inline code only so the ISR has
+ * no call and its prologue is short:
+ * 1. IN1 = 1 then IN2 = 1 of every channel, two SBI each: a CW or A-CW motor goes straight
+ *    to brake, never to the other direction.
+ * 2. Enables fully on (channel 0 compare value, channel 1 software PWM pin),
+ *    the brakes are not chopped by the PWM.
+ * 3. Disable the Timer0 overflow interrupt and lock the motor outputs: the ramp, PI and software
+ *    PWM tasks can not drive the motors again until the sequencer brings the motor driver to the
+ *    braked state, even the motor task this ISR interrupted (it runs with the interrupts enabled).
+ */
+static inline __attribute__((always_inline)) void EStop_brake(void)
+{
+	GPIO_writePinInline(DC_MOTOR0_IN1_PORT_ID,DC_MOTOR0_IN1_PIN_ID,LOGIC_HIGH);
+	GPIO_writePinInline(DC_MOTOR0_IN2_PORT_ID,DC_MOTOR0_IN2_PIN_ID,LOGIC_HIGH);
+#if (DC_MOTOR_NUM_CHANNELS > 1)
+	GPIO_writePinInline(DC_MOTOR1_IN1_PORT_ID,DC_MOTOR1_IN1_PIN_ID,LOGIC_HIGH);
+	GPIO_writePinInline(DC_MOTOR1_IN2_PORT_ID,DC_MOTOR1_IN2_PIN_ID,LOGIC_HIGH);
+	GPIO_writePinInline(DC_MOTOR1_EN_PORT_ID,DC_MOTOR1_EN_PIN_ID,LOGIC_HIGH);
+#endif
+	PWM_Timer0_setCompareValueInline(0xFF);
+	PWM_Timer0_disableCallBackInline();
+	DcMotor_lockOutputsInline();
+}
+
+/*
+ * Description :
+ * Record the event from the ISRs after the brake, inlined too:
+ * 1. Keep the event for EStop_getEvent and count it.
+ * 2. Post the sequencer work item, unless it is still in the queue: the sequencer reads
+ *    the last event when it runs, so the queue holds one e-stop item at most.
+ */
+static inline __attribute__((always_inline)) void EStop_postEvent(EStop_EventType event)
+{
+	g_event = event;
+	if(g_events != 0xFF)
+	{
+		g_events++;
+	}
+	if(!g_eventPosted && (g_callBackPtr != NULL_PTR))
+	{
+		g_eventPosted = WorkQueue_postInline(g_callBackPtr, 0);
+	}
+}
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+/* External Interrupt 0 ISR, the door is obstructed */
+ISR(INT0_vect)
+{
+	EStop_brake();
+	EStop_postEvent(ESTOP_OBSTRUCTION);
+}
+
+/* External Interrupt 1 ISR, the emergency stop button is pressed, it overrides an obstruction */
+ISR(INT1_vect)
+{
+	EStop_brake();
+	EStop_postEvent(ESTOP_EMERGENCY);
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Setup the inputs with the internal pull-ups and enable INT0 and INT1 on the falling edge,
+ * ISCx1 = 1 and ISCx0 = 0, the flags are cleared after that to avoid a false interrupt.
+ */
+void EStop_init(void)
+{
+	GPIO_setupPinDirectionInline(ESTOP_OBSTRUCTION_PORT_ID,ESTOP_OBSTRUCTION_PIN_ID,PIN_INPUT);
+	GPIO_writePinInline(ESTOP_OBSTRUCTION_PORT_ID,ESTOP_OBSTRUCTION_PIN_ID,LOGIC_HIGH);
+	GPIO_setupPinDirectionInline(ESTOP_BUTTON_PORT_ID,ESTOP_BUTTON_PIN_ID,PIN_INPUT);
+	GPIO_writePinInline(ESTOP_BUTTON_PORT_ID,ESTOP_BUTTON_PIN_ID,LOGIC_HIGH);
+
+	MCUCR = (MCUCR & 0xF0) | (1<<ISC11) | (1<<ISC01);
+	GIFR = (1<<INTF0) | (1<<INTF1);
+	GICR |= (1<<INT0) | (1<<INT1);
+}
+
+/*
+ * Description :
+ * Set the work item posted by the ISRs after a brake, it runs in the main context.
+ */
+void EStop_setCallBack(WorkQueue_HandlerType a_ptr)
+{
+	g_callBackPtr = a_ptr;
+}
+
+/*
+ * Description :
+ * Return the last event and clear it, the next event posts the work item again.
+ */
+EStop_EventType EStop_getEvent(void)
+{
+	EStop_EventType event;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		event = g_event;
+		g_event = ESTOP_NONE;
+		g_eventPosted = FALSE;
+	}
+	return event;
+}
+
+/*
+ * Description :
+ * Return TRUE while the obstruction or the emergency stop input is active (LOW).
+ */
+boolean EStop_isInputActive(void)
+{
+	return (GPIO_readPinInline(ESTOP_OBSTRUCTION_PORT_ID,ESTOP_OBSTRUCTION_PIN_ID) == LOGIC_LOW)
+			|| (GPIO_readPinInline(ESTOP_BUTTON_PORT_ID,ESTOP_BUTTON_PIN_ID) == LOGIC_LOW);
+}
+
+/*
+ * Description :
+ * Return the number of brakes since reset, saturated at 255.
+ */
+uint8 EStop_getEventCount(void)
+{
+	return g_events;
+}
@@ -0,0 +1,90 @@
+ /******************************************************************************
+ *
+ * Module: Emergency Stop
+ *
+ * File Name: estop.h
+ *
+ * Description: Header file for the obstruction and emergency stop inputs driver
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+
+#ifndef ESTOP_H_
+#define ESTOP_H_
+
+#include "std_types.h"
+#include "gpio.h"
+#include "work_queue.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+/*
+ * Inputs to ground with the internal pull-ups, active (LOW) while the door is obstructed
+ * or the emergency stop button is pressed, the falling edge interrupts the CPU:
+ * obstruction sensor on INT0 (PD2), emergency stop button on INT1 (PD3).
+ * INT0 and INT1 have the highest interrupt priorities after reset.
+ */
+#define ESTOP_OBSTRUCTION_PORT_ID       PORTD_ID
+#define ESTOP_OBSTRUCTION_PIN_ID        PIN2_ID
+#define ESTOP_BUTTON_PORT_ID            PORTD_ID
+#define ESTOP_BUTTON_PIN_ID             PIN3_ID
+
+/*
+ * Brake latency: the ISR brakes with inline code only, but it waits for any ISR or interrupts-off
+ * section running at the edge. The long ISRs run their work with the interrupts enabled
+ * (ISR_NOBLOCK): the Timer0 overflow motor task (ramps, PI loops, software PWM) and the ADC
+ * current sense; they lock the motor outputs against a brake that interrupted them
+ * (DcMotor_lockOutputsInline). The remaining blockers are short: the Timer1 tick and capture,
+ * INT2, Timer2 buzzer and UART receive ISRs, the entry of the ISR_NOBLOCK ISRs,
+ * and the ATOMIC blocks of the main context.
+ * The worst case latency, from the INT0/INT1 edge to the door 0 IN2 pin, is not measured yet:
+ * it has to be measured on the target in both the -O0 Debug and the -Os Release builds,
+ * no figure is given here.
+ */
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+typedef enum {
+	ESTOP_NONE, ESTOP_OBSTRUCTION, ESTOP_EMERGENCY
+}EStop_EventType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Setup the inputs with the internal pull-ups and enable INT0 and INT1 on the falling edge.
+ */
+void EStop_init(void);
+
+/*
+ * Description :
+ * Set the work item the ISRs post to the work queue after a brake, its handler must call
+ * EStop_getEvent. It runs in the main context with WorkQueue_runPending.
+ */
+void EStop_setCallBack(WorkQueue_HandlerType a_ptr);
+
+/*
+ * Description :
+ * Return the last event and clear it, all the motors were already braked by the ISR.
+ * The sequencer must call DcMotor_brake for every motor to bring the motor driver to the braked state.
+ */
+EStop_EventType EStop_getEvent(void);
+
+/*
+ * Description :
+ * Return TRUE while the obstruction or the emergency stop input is active.
+ */
+boolean EStop_isInputActive(void);
+
+/*
+ * Description :
+ * Return the number of brakes since reset, saturated at 255.
+ */
+uint8 EStop_getEventCount(void);
+
+#endif /* ESTOP_H_ */
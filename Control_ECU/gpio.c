@@ -329,3 +329,108 @@ uint8 GPIO_readPort(uint8 port_num)
 
 	return value;
 }
+
+/*
+ * Description :
+ * Set the pins of set_mask and clear the pins of clear_mask of the required port in one write,
+ * with the global interrupts disabled so an ISR can not change the port in the middle.
+ * A pin in both masks is set. The other pins keep their values.
+ * If the input port number is not correct, The function will not handle the request.
+ */
+void GPIO_writePortMasked(uint8 port_num, uint8 set_mask, uint8 clear_mask)
+{
+	/*
+	 * Check if the input number is greater than NUM_OF_PORTS value.
+	 * In this case the input is not valid port number
+	 */
+	if(port_num >= NUM_OF_PORTS)
+	{
+		/* Do Nothing */
+	}
+	else
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			/* Write the port pins as required */
+			switch(port_num)
+			{
+			case PORTA_ID:
+				PORTA = (PORTA & (uint8)~clear_mask) | set_mask;
+				break;
+			case PORTB_ID:
+				PORTB = (PORTB & (uint8)~clear_mask) | set_mask;
+				break;
+			case PORTC_ID:
+				PORTC = (PORTC & (uint8)~clear_mask) | set_mask;
+				break;
+			case PORTD_ID:
+				PORTD = (PORTD & (uint8)~clear_mask) | set_mask;
+				break;
+			}
+		}
+	}
+}
+
+/*
+ * Description :
+ * Start a new empty pins batch.
+ */
+void GPIO_initTransaction(GPIO_TransactionType *transaction)
+{
+	uint8 port_num;
+
+	for(port_num = 0; port_num < NUM_OF_PORTS; port_num++)
+	{
+		transaction->set_mask[port_num] = 0;
+		transaction->clear_mask[port_num] = 0;
+	}
+}
+
+/*
+ * Description :
+ * Add the required pin value to the pins batch, the pin is not written until the batch is committed.
+ * If the input port number or pin number are not correct, The function will not handle the request.
+ */
+void GPIO_transactionWritePin(GPIO_TransactionType *transaction, uint8 port_num, uint8 pin_num, uint8 value)
+{
+	/*
+	 * Check if the input port number is greater than NUM_OF_PORTS value.
+	 * Or if the input pin number is greater than NUM_OF_PINS_PER_PORT value.
+	 * In this case the input is not valid.
+	 */
+	if((pin_num >= NUM_OF_PINS_PER_PORT) || (port_num >= NUM_OF_PORTS))
+	{
+		/* Do Nothing */
+	}
+	else if(value == LOGIC_HIGH)
+	{
+		SET_BIT(transaction->set_mask[port_num],pin_num);
+		CLEAR_BIT(transaction->clear_mask[port_num],pin_num);
+	}
+	else
+	{
+		SET_BIT(transaction->clear_mask[port_num],pin_num);
+		CLEAR_BIT(transaction->set_mask[port_num],pin_num);
+	}
+}
+
+/*
+ * Description :
+ * Apply the pins batch, one masked write per port that has pins in the batch,
+ * all the ports are written back to back with the global interrupts disabled.
+ */
+void GPIO_commitTransaction(const GPIO_TransactionType *transaction)
+{
+	uint8 port_num;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		for(port_num = 0; port_num < NUM_OF_PORTS; port_num++)
+		{
+			if((transaction->set_mask[port_num] | transaction->clear_mask[port_num]) != 0)
+			{
+				GPIO_writePortMasked(port_num,transaction->set_mask[port_num],transaction->clear_mask[port_num]);
+			}
+		}
+	}
+}
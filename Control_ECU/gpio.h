@@ -14,6 +14,8 @@
 #define GPIO_H_
 
 #include "std_types.h"
+#include <avr/io.h> /* To use the IO Ports Registers in the inline functions */
+#include <util/atomic.h> /* For the interrupt safe masked port write */
 
 /*******************************************************************************
  *                                Definitions                                  *
@@ -48,6 +50,16 @@ typedef enum
 	PORT_INPUT,PORT_OUTPUT=0xFF
 }GPIO_PortDirectionType;
 
+/*
+ * Batch of pin writes on one or more ports, collected by GPIO_transactionWritePin
+ * and applied by GPIO_commitTransaction, bit n of a mask is pin n of the port
+ */
+typedef struct
+{
+	uint8 set_mask[NUM_OF_PORTS];
+	uint8 clear_mask[NUM_OF_PORTS];
+}GPIO_TransactionType;
+
 /*******************************************************************************
  *                              Functions Prototypes                           *
  *******************************************************************************/
@@ -99,4 +111,135 @@ void GPIO_writePort(uint8 port_num, uint8 value);
  */
 uint8 GPIO_readPort(uint8 port_num);
 
+/*
+ * Description :
+ * Set the pins of set_mask and clear the pins of clear_mask of the required port in one write,
+ * with the global interrupts disabled so an ISR can not change the port in the middle.
+ * A pin in both masks is set. The other pins keep their values.
+ * If the input port number is not correct, The function will not handle the request.
+ */
+void GPIO_writePortMasked(uint8 port_num, uint8 set_mask, uint8 clear_mask);
+
+/*
+ * Description :
+ * Start a new empty pins batch.
+ */
+void GPIO_initTransaction(GPIO_TransactionType *transaction);
+
+/*
+ * Description :
+ * Add the required pin value to the pins batch, the pin is not written until the batch is committed.
+ * If the input port number or pin number are not correct, The function will not handle the request.
+ */
+void GPIO_transactionWritePin(GPIO_TransactionType *transaction, uint8 port_num, uint8 pin_num, uint8 value);
+
+/*
+ * Description :
+ * Apply the pins batch, one masked write per port that has pins in the batch,
+ * all the ports are written back to back with the global interrupts disabled.
+ */
+void GPIO_commitTransaction(const GPIO_TransactionType *transaction);
+
+/*******************************************************************************
+ *                     Inline Functions (compile-time pins)                    *
+ *******************************************************************************/
+/*
+ * Inline versions of the pin functions for drivers that pass constant port and pin ids.
+ * They are always inlined, so there is no call and no arguments check in any build.
+ * The port register is selected at compile time only with optimization (the Release -Os build):
+ * then every pin function is one SBI/CBI (2 cycles) or SBIS/SBIC instruction and the port
+ * functions one IN/OUT instruction, instead of a GPIO_writePin call with its argument loads,
+ * port switch and pin mask loop. The Debug -O0 build keeps the port selection at run time.
+ * SBI and CBI also change the pin without a read-modify-write, so they are interrupt safe.
+ * The arguments are not checked, use the GPIO driver functions for run-time port and pin ids.
+ */
+
+/* IO registers of a port id, the constant port id selects one address at compile time */
+#define GPIO_PORT_REG(port_num)   (*(((port_num) == PORTA_ID) ? &PORTA : ((port_num) == PORTB_ID) ? &PORTB : \
+		((port_num) == PORTC_ID) ? &PORTC : &PORTD))
+#define GPIO_DDR_REG(port_num)    (*(((port_num) == PORTA_ID) ? &DDRA : ((port_num) == PORTB_ID) ? &DDRB : \
+		((port_num) == PORTC_ID) ? &DDRC : &DDRD))
+#define GPIO_PIN_REG(port_num)    (*(((port_num) == PORTA_ID) ? &PINA : ((port_num) == PORTB_ID) ? &PINB : \
+		((port_num) == PORTC_ID) ? &PINC : &PIND))
+
+/*
+ * Description :
+ * Inline version of GPIO_setupPinDirection for constant port and pin ids.
+ */
+static inline __attribute__((always_inline)) void GPIO_setupPinDirectionInline(uint8 port_num, uint8 pin_num, GPIO_PinDirectionType direction)
+{
+	if(direction == PIN_OUTPUT)
+	{
+		GPIO_DDR_REG(port_num) |= (uint8)(1<<pin_num);
+	}
+	else
+	{
+		GPIO_DDR_REG(port_num) &= (uint8)~(1<<pin_num);
+	}
+}
+
+/*
+ * Description :
+ * Inline version of GPIO_writePin for constant port and pin ids.
+ */
+static inline __attribute__((always_inline)) void GPIO_writePinInline(uint8 port_num, uint8 pin_num, uint8 value)
+{
+	if(value == LOGIC_HIGH)
+	{
+		GPIO_PORT_REG(port_num) |= (uint8)(1<<pin_num);
+	}
+	else
+	{
+		GPIO_PORT_REG(port_num) &= (uint8)~(1<<pin_num);
+	}
+}
+
+/*
+ * Description :
+ * Inline version of GPIO_readPin for constant port and pin ids.
+ */
+static inline __attribute__((always_inline)) uint8 GPIO_readPinInline(uint8 port_num, uint8 pin_num)
+{
+	return (GPIO_PIN_REG(port_num) & (uint8)(1<<pin_num)) ? LOGIC_HIGH : LOGIC_LOW;
+}
+
+/*
+ * Description :
+ * Inline version of GPIO_writePortMasked for a constant port id.
+ */
+static inline __attribute__((always_inline)) void GPIO_writePortMaskedInline(uint8 port_num, uint8 set_mask, uint8 clear_mask)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		GPIO_PORT_REG(port_num) = (GPIO_PORT_REG(port_num) & (uint8)~clear_mask) | set_mask;
+	}
+}
+
+/*
+ * Description :
+ * Inline version of GPIO_setupPortDirection for a constant port id.
+ */
+static inline __attribute__((always_inline)) void GPIO_setupPortDirectionInline(uint8 port_num, GPIO_PortDirectionType direction)
+{
+	GPIO_DDR_REG(port_num) = direction;
+}
+
+/*
+ * Description :
+ * Inline version of GPIO_writePort for a constant port id.
+ */
+static inline __attribute__((always_inline)) void GPIO_writePortInline(uint8 port_num, uint8 value)
+{
+	GPIO_PORT_REG(port_num) = value;
+}
+
+/*
+ * Description :
+ * Inline version of GPIO_readPort for a constant port id.
+ */
+static inline __attribute__((always_inline)) uint8 GPIO_readPortInline(uint8 port_num)
+{
+	return GPIO_PIN_REG(port_num);
+}
+
 #endif /* GPIO_H_ */
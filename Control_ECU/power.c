@@ -0,0 +1,152 @@
+/******************************************************************************
+ *
+ * Module: Power Management
+ *
+ * File Name: power.c
+ *
+ * Description: Source file for the Control ECU idle sleep and power statistics
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+#include "power.h"
+#include <avr/io.h> /* To use Timer1 Registers */
+#include <avr/interrupt.h> /* For sei */
+#include <avr/sleep.h> /* For the sleep instruction */
+#include "common_macros.h"
+#include "timer1.h"
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+#if (POWER_STATS_ENABLE == TRUE)
+/* Number of system ticks, extended from the 16-bit Timer1 tick count, then by TCNT1 to the time base */
+static uint32 g_timeBaseTicks = 0;
+static uint16 g_lastTicks = 0;
+/* Accumulated time spent in idle sleep */
+static uint32 g_asleepTicks = 0;
+/* Number of wake ups from idle sleep */
+static uint32 g_wakeups = 0;
+#endif
+
+/* Task run instead of the idle sleep while it has work */
+static boolean (*g_idleTaskPtr)(void) = NULL_PTR;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+#if (POWER_STATS_ENABLE == TRUE)
+/*
+ * Description :
+ * Private function to read the 32-bit statistics time base, called with interrupts disabled.
+ * The ticks counted by the Timer1 ISR since the last call are added to the 32-bit tick count,
+ * it is called at least every system tick task so the 16-bit count can not wrap in between.
+ * If the compare match flag is still pending the tick ISR did not count it yet, so count it here.
+ */
+static uint32 Power_getTimeBase(void)
+{
+	uint16 count = TCNT1;
+	uint16 newTicks = Timer1_getTicks();
+	uint32 ticks;
+
+	g_timeBaseTicks += (uint16)(newTicks - g_lastTicks);
+	g_lastTicks = newTicks;
+	ticks = g_timeBaseTicks;
+
+	if(BIT_IS_SET(TIFR,OCF1A) && (count < (POWER_TIMER_COUNTS_PER_TICK / 2)))
+	{
+		ticks++;
+	}
+	return (ticks * (1000 / POWER_STATS_TICK_US)) + (count / POWER_STATS_TICK_US);
+}
+#endif
+
+/*
+ * Description :
+ * Initialize the power module: select the idle sleep mode, the UART, TWI and timers keep
+ * running and wake the CPU. The statistics time base is counted by Power_tickTask.
+ */
+void Power_init(void)
+{
+	set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+/*
+ * Description :
+ * Called every system tick (1 msec) from the main context: extend the statistics time base.
+ */
+void Power_tickTask(void)
+{
+#if (POWER_STATS_ENABLE == TRUE)
+	uint8 sreg = SREG;
+
+	cli();
+	(void)Power_getTimeBase();
+	SREG = sreg;
+#endif
+}
+
+/*
+ * Description :
+ * Set the task run by Power_enterIdle instead of sleeping while it has work.
+ */
+void Power_setIdleTask(boolean (*a_ptr)(void))
+{
+	g_idleTaskPtr = a_ptr;
+}
+
+/*
+ * Description :
+ * Put the CPU in idle sleep until the next interrupt, unless the idle task has work to run.
+ * The idle task checks its work with the interrupts still disabled, so work posted or counted by an ISR
+ * is either run now or its ISR wakes the CPU.
+ * The instruction after SEI is always executed before any pending interrupt,
+ * so the sleep instruction is reached even if the wake up interrupt is already pending,
+ * and that interrupt wakes the CPU immediately.
+ */
+void Power_enterIdle(void)
+{
+#if (POWER_STATS_ENABLE == TRUE)
+	uint32 sleepStart;
+#endif
+
+	if((g_idleTaskPtr != NULL_PTR) && (*g_idleTaskPtr)())
+	{
+		return;
+	}
+#if (POWER_STATS_ENABLE == TRUE)
+	sleepStart = Power_getTimeBase();
+#endif
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+
+#if (POWER_STATS_ENABLE == TRUE)
+	cli();
+	g_asleepTicks += Power_getTimeBase() - sleepStart;
+	g_wakeups++;
+	sei();
+#endif
+}
+
+/*
+ * Description :
+ * Get the asleep/awake time statistics since Power_init.
+ */
+void Power_getStats(Power_StatsType *stats)
+{
+#if (POWER_STATS_ENABLE == TRUE)
+	uint8 sreg = SREG;
+
+	cli();
+	stats->asleep_ticks = g_asleepTicks;
+	stats->awake_ticks = Power_getTimeBase() - g_asleepTicks;
+	stats->wakeups = g_wakeups;
+	SREG = sreg;
+#else
+	stats->asleep_ticks = 0;
+	stats->awake_ticks = 0;
+	stats->wakeups = 0;
+#endif
+}
@@ -0,0 +1,80 @@
+/******************************************************************************
+ *
+ * Module: Power Management
+ *
+ * File Name: power.h
+ *
+ * Description: Header file for the Control ECU idle sleep and power statistics
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+/* Set to FALSE to remove the asleep/awake time statistics */
+#define POWER_STATS_ENABLE              TRUE
+
+/*
+ * The statistics time base is the Timer1 tick count (1 msec) extended to 32 bits and by the Timer1 count (1 usec),
+ * one statistics tick = 125usec (8 per system tick), the 32-bit counters wrap after 6.2 days.
+ */
+#define POWER_STATS_TICK_US             125
+#define POWER_TIMER_COUNTS_PER_TICK     1000
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+typedef struct {
+	uint32 asleep_ticks;  /* Time spent in idle sleep, in statistics ticks */
+	uint32 awake_ticks;   /* Time spent running, in statistics ticks */
+	uint32 wakeups;       /* Number of times the CPU left idle sleep */
+}Power_StatsType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Initialize the power module: select the idle sleep mode, the UART, TWI and timers keep
+ * running and wake the CPU. The statistics time base is counted by Power_tickTask.
+ */
+void Power_init(void);
+
+/*
+ * Description :
+ * Called every system tick (1 msec) from the main context: extend the statistics time base.
+ */
+void Power_tickTask(void);
+
+/*
+ * Description :
+ * Set the task run by Power_enterIdle instead of sleeping while it has work, like
+ * WorkQueue_runPending or Timer1_runPendingTicks: called with the global interrupts disabled, it returns FALSE with them
+ * still disabled if it has no work, else it enables them, runs its work and returns TRUE.
+ */
+void Power_setIdleTask(boolean (*a_ptr)(void));
+
+/*
+ * Description :
+ * Put the CPU in idle sleep until the next interrupt, or run the work of the idle task instead.
+ * It must be called with the global interrupts disabled, right after the caller found
+ * that it has no work to do, so an interrupt can not slip in between the check and the sleep.
+ * The function returns with the global interrupts enabled, and the caller checks its work again.
+ */
+void Power_enterIdle(void);
+
+/*
+ * Description :
+ * Get the asleep/awake time statistics since Power_init.
+ */
+void Power_getStats(Power_StatsType *stats);
+
+#endif /* POWER_H_ */
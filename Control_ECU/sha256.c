@@ -0,0 +1,201 @@
+ /******************************************************************************
+ *
+ * Module: SHA-256
+ *
+ * File Name: sha256.c
+ *
+ * Description: Source file for the SHA-256 hash (FIPS 180-4) for the 8-bit AVR
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+#include "sha256.h"
+#include <avr/pgmspace.h> /* For the constants tables in flash */
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+#define SHA256_ROTR(x, n)        (((x) >> (n)) | ((x) << (32 - (n))))
+#define SHA256_CH(x, y, z)       (((x) & (y)) ^ (~(x) & (z)))
+#define SHA256_MAJ(x, y, z)      (((x) & (y)) | ((z) & ((x) | (y))))
+#define SHA256_BSIG0(x)          (SHA256_ROTR(x, 2) ^ SHA256_ROTR(x, 13) ^ SHA256_ROTR(x, 22))
+#define SHA256_BSIG1(x)          (SHA256_ROTR(x, 6) ^ SHA256_ROTR(x, 11) ^ SHA256_ROTR(x, 25))
+#define SHA256_SSIG0(x)          (SHA256_ROTR(x, 7) ^ SHA256_ROTR(x, 18) ^ ((x) >> 3))
+#define SHA256_SSIG1(x)          (SHA256_ROTR(x, 17) ^ SHA256_ROTR(x, 19) ^ ((x) >> 10))
+
+/* Offset of the 64-bit message length in bits at the end of the last block */
+#define SHA256_LENGTH_OFFSET     (SHA256_BLOCK_SIZE - 8)
+
+/*******************************************************************************
+ *                         Flash Tables (Private)                              *
+ *******************************************************************************/
+/* Initial hash value */
+static const uint32 Sha256_initialState[8] PROGMEM = {
+	0x6A09E667UL, 0xBB67AE85UL, 0x3C6EF372UL, 0xA54FF53AUL,
+	0x510E527FUL, 0x9B05688CUL, 0x1F83D9ABUL, 0x5BE0CD19UL
+};
+
+/* Round constants, read one per round so the 256 bytes stay out of the 2 KB SRAM */
+static const uint32 Sha256_k[64] PROGMEM = {
+	0x428A2F98UL, 0x71374491UL, 0xB5C0FBCFUL, 0xE9B5DBA5UL, 0x3956C25BUL, 0x59F111F1UL, 0x923F82A4UL, 0xAB1C5ED5UL,
+	0xD807AA98UL, 0x12835B01UL, 0x243185BEUL, 0x550C7DC3UL, 0x72BE5D74UL, 0x80DEB1FEUL, 0x9BDC06A7UL, 0xC19BF174UL,
+	0xE49B69C1UL, 0xEFBE4786UL, 0x0FC19DC6UL, 0x240CA1CCUL, 0x2DE92C6FUL, 0x4A7484AAUL, 0x5CB0A9DCUL, 0x76F988DAUL,
+	0x983E5152UL, 0xA831C66DUL, 0xB00327C8UL, 0xBF597FC7UL, 0xC6E00BF3UL, 0xD5A79147UL, 0x06CA6351UL, 0x14292967UL,
+	0x27B70A85UL, 0x2E1B2138UL, 0x4D2C6DFCUL, 0x53380D13UL, 0x650A7354UL, 0x766A0ABBUL, 0x81C2C92EUL, 0x92722C85UL,
+	0xA2BFE8A1UL, 0xA81A664BUL, 0xC24B8B70UL, 0xC76C51A3UL, 0xD192E819UL, 0xD6990624UL, 0xF40E3585UL, 0x106AA070UL,
+	0x19A4C116UL, 0x1E376C08UL, 0x2748774CUL, 0x34B0BCB5UL, 0x391C0CB3UL, 0x4ED8AA4AUL, 0x5B9CCA4FUL, 0x682E6FF3UL,
+	0x748F82EEUL, 0x78A5636FUL, 0x84C87814UL, 0x8CC70208UL, 0x90BEFFFAUL, 0xA4506CEBUL, 0xBEF9A3F7UL, 0xC67178F2UL
+};
+
+/*******************************************************************************
+ *                      Functions Definitions (Private)                        *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Private function to compress the full block into the hash value.
+ * The message schedule is kept as a rolling window of 16 words (64 bytes of stack
+ * instead of 256), word t is computed in place of word t-16.
+ */
+static void Sha256_compress(Sha256_ContextType *context)
+{
+	uint32 w[16];
+	uint32 a, b, c, d, e, f, g, h;
+	uint32 t1, t2;
+	uint8 t;
+
+	for(t = 0; t < 16; t++)
+	{
+		w[t] = ((uint32)context->block[4 * t] << 24) | ((uint32)context->block[(4 * t) + 1] << 16)
+				| ((uint32)context->block[(4 * t) + 2] << 8) | context->block[(4 * t) + 3];
+	}
+
+	a = context->state[0];
+	b = context->state[1];
+	c = context->state[2];
+	d = context->state[3];
+	e = context->state[4];
+	f = context->state[5];
+	g = context->state[6];
+	h = context->state[7];
+
+	for(t = 0; t < 64; t++)
+	{
+		if(t >= 16)
+		{
+			w[t & 15] += SHA256_SSIG1(w[(t - 2) & 15]) + w[(t - 7) & 15] + SHA256_SSIG0(w[(t - 15) & 15]);
+		}
+		t1 = h + SHA256_BSIG1(e) + SHA256_CH(e, f, g) + pgm_read_dword(&Sha256_k[t]) + w[t & 15];
+		t2 = SHA256_BSIG0(a) + SHA256_MAJ(a, b, c);
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	context->state[0] += a;
+	context->state[1] += b;
+	context->state[2] += c;
+	context->state[3] += d;
+	context->state[4] += e;
+	context->state[5] += f;
+	context->state[6] += g;
+	context->state[7] += h;
+	context->block_length = 0;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Start a new hash with the initial hash value.
+ */
+void Sha256_init(Sha256_ContextType *context)
+{
+	uint8 i;
+
+	for(i = 0; i < 8; i++)
+	{
+		context->state[i] = pgm_read_dword(&Sha256_initialState[i]);
+	}
+	context->length = 0;
+	context->block_length = 0;
+}
+
+/*
+ * Description :
+ * Add bytes to the message, every full block is compressed at once.
+ */
+void Sha256_update(Sha256_ContextType *context, const uint8 *data, uint8 size)
+{
+	uint8 i;
+
+	for(i = 0; i < size; i++)
+	{
+		context->block[context->block_length] = data[i];
+		context->block_length++;
+		if(context->block_length == SHA256_BLOCK_SIZE)
+		{
+			Sha256_compress(context);
+		}
+	}
+	context->length += size;
+}
+
+/*
+ * Description :
+ * Pad the message: one bit, zeros up to the length field, then the 64-bit length in bits
+ * (an extra block is compressed if the length does not fit after the message).
+ * Write the digest in big endian and clear the context, it held the message.
+ */
+void Sha256_final(Sha256_ContextType *context, uint8 digest[SHA256_DIGEST_SIZE])
+{
+	uint32 bits = context->length << 3;
+	uint8 i;
+
+	context->block[context->block_length] = 0x80;
+	context->block_length++;
+	if(context->block_length > SHA256_LENGTH_OFFSET)
+	{
+		while(context->block_length < SHA256_BLOCK_SIZE)
+		{
+			context->block[context->block_length] = 0;
+			context->block_length++;
+		}
+		Sha256_compress(context);
+	}
+	while(context->block_length < (SHA256_BLOCK_SIZE - 4))
+	{
+		context->block[context->block_length] = 0;
+		context->block_length++;
+	}
+	/* The length in bytes is below 512 MB, the upper 32 bits of the length in bits are zero */
+	context->block[SHA256_BLOCK_SIZE - 4] = (uint8)(bits >> 24);
+	context->block[SHA256_BLOCK_SIZE - 3] = (uint8)(bits >> 16);
+	context->block[SHA256_BLOCK_SIZE - 2] = (uint8)(bits >> 8);
+	context->block[SHA256_BLOCK_SIZE - 1] = (uint8)bits;
+	Sha256_compress(context);
+
+	for(i = 0; i < 8; i++)
+	{
+		digest[4 * i] = (uint8)(context->state[i] >> 24);
+		digest[(4 * i) + 1] = (uint8)(context->state[i] >> 16);
+		digest[(4 * i) + 2] = (uint8)(context->state[i] >> 8);
+		digest[(4 * i) + 3] = (uint8)context->state[i];
+	}
+
+	for(i = 0; i < SHA256_BLOCK_SIZE; i++)
+	{
+		context->block[i] = 0;
+	}
+	for(i = 0; i < 8; i++)
+	{
+		context->state[i] = 0;
+	}
+}
@@ -0,0 +1,65 @@
+ /******************************************************************************
+ *
+ * Module: SHA-256
+ *
+ * File Name: sha256.h
+ *
+ * Description: Header file for the SHA-256 hash (FIPS 180-4) for the 8-bit AVR
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+
+#ifndef SHA256_H_
+#define SHA256_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+#define SHA256_BLOCK_SIZE               64
+#define SHA256_DIGEST_SIZE              32
+
+/*
+ * Memory fixed by the source, every message up to 55 bytes is one compression:
+ * 288 bytes of flash tables (round constants and initial hash value), a 101 bytes context
+ * and the 64 bytes message schedule on the stack of the compression.
+ * The code size and the cycles of a compression are not measured: no figure is given for them.
+ * The code size is the sha256.o line of avr-size in the Release build, and the time of every
+ * password hash is measured at run time in both builds, see getPasswordHashStats.
+ */
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+typedef struct {
+	uint32 state[8];                  /* Hash value H0..H7 */
+	uint32 length;                    /* Message length in bytes */
+	uint8 block[SHA256_BLOCK_SIZE];   /* Block being filled */
+	uint8 block_length;               /* Bytes in the block */
+}Sha256_ContextType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Start a new hash with the initial hash value.
+ */
+void Sha256_init(Sha256_ContextType *context);
+
+/*
+ * Description :
+ * Add bytes to the message, every full block is compressed at once.
+ */
+void Sha256_update(Sha256_ContextType *context, const uint8 *data, uint8 size);
+
+/*
+ * Description :
+ * Pad the message, write the 32 bytes digest (big endian) and clear the context.
+ */
+void Sha256_final(Sha256_ContextType *context, uint8 digest[SHA256_DIGEST_SIZE]);
+
+#endif /* SHA256_H_ */
@@ -12,36 +12,48 @@
 #include "timer1.h"
 #include <avr/io.h> /* To use Timer1 Registers */
 #include <avr/interrupt.h> /* For Timer1 ISR */
+#include <util/atomic.h> /* To read the tick counter updated by the ISR */
 #include "std_types.h"
 
 /*******************************************************************************
  *                           Global Variables                                  *
  *******************************************************************************/
 
-/* Global variables to hold the address of the call back function in the application */
-static volatile void (*g_callBackPtr)(void) = NULL_PTR;
+/* Global variable to hold the address of the call back function in the application */
+static void (*volatile g_callBackPtr)(void) = NULL_PTR;
+
+/*
+ * Ticks (compare matches or overflows) counted by the ISR, and the ones the call back did not run yet.
+ * The tick count is also read by the other ISRs through Timer1_getTicksInline.
+ */
+volatile uint16 g_timer1Ticks = 0;
+static volatile uint8 g_pendingTicks = 0;
 
 /*******************************************************************************
  *                       Interrupt Service Routines                            *
  *******************************************************************************/
 
-/* Timer1 CTC Mode ISR */
+/*
+ * Timer1 CTC Mode ISR, count the tick inline: the call back is run later for every pending tick
+ * by Timer1_runPendingTicks in the main context. Without a function call avr-gcc only saves
+ * the registers the counters need instead of all the call-clobbered registers.
+ */
 ISR(TIMER1_COMPA_vect)
 {
-	if(g_callBackPtr != NULL_PTR)
+	g_timer1Ticks++;
+	if(g_pendingTicks != 0xFF)
 	{
-		/* Call the Call Back function in the application after the edge is detected */
-		(*g_callBackPtr)(); /* another method to call the function using pointer to function g_callBackPtr(); */
+		g_pendingTicks++;
 	}
 }
 
-/* Timer1 Normal Mode ISR */
+/* Timer1 Normal Mode ISR, the same inline tick count */
 ISR(TIMER1_OVF_vect)
 {
-	if(g_callBackPtr != NULL_PTR)
+	g_timer1Ticks++;
+	if(g_pendingTicks != 0xFF)
 	{
-		/* Call the Call Back function in the application after the edge is detected */
-		(*g_callBackPtr)(); /* another method to call the function using pointer to function g_callBackPtr(); */
+		g_pendingTicks++;
 	}
 }
 
@@ -59,6 +71,8 @@ void Timer1_init(const Timer1_ConfigType * Config_Ptr)
 {
 	/* Initial Value for Timer1 */
 	TCNT1 = Config_Ptr->initial_value;
+	g_timer1Ticks = 0;
+	g_pendingTicks = 0;
 
 	/* Set the required mode */
 	/* Non-PWM Mode */
@@ -98,8 +112,8 @@ void Timer1_deInit(void)
 	TCNT1  = 0;
 	OCR1A  = 0;
 
-	/*Disable Timer1 Normal Mode and CTC Mode Interrupts*/
-	TIMSK  &= ~(1 << TOIE1) & ~(1 << OCIE1A);
+	/*Disable Timer1 Normal Mode, CTC Mode and Input Capture Interrupts*/
+	TIMSK  &= ~(1 << TOIE1) & ~(1 << OCIE1A) & ~(1 << TICIE1);
 }
 /*
  * Description :
@@ -110,3 +124,73 @@ void Timer1_setCallBack(void(*a_ptr)(void))
 	/* Save the address of the Call back function in a global variable */
 	g_callBackPtr = a_ptr;
 }
+
+/*
+ * Description :
+ * Function to return the number of ticks counted by the ISR, it wraps after 65536 ticks
+ */
+uint16 Timer1_getTicks(void)
+{
+	uint16 ticks;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ticks = g_timer1Ticks;
+	}
+	return ticks;
+}
+
+/*
+ * Description :
+ * Function to run the call back once for every tick counted since the last call:
+ * - No pending tick: return FALSE at once, the global interrupts are not changed.
+ * - Else take the pending ticks with the interrupts disabled, then enable them, run the call back
+ *   and return TRUE. The ISR saturates at 255 pending ticks, older ones are lost.
+ */
+boolean Timer1_runPendingTicks(void)
+{
+	uint8 ticks = g_pendingTicks;
+
+	if(ticks == 0)
+	{
+		return FALSE;
+	}
+	cli();
+	ticks = g_pendingTicks;
+	g_pendingTicks = 0;
+	sei();
+	if(g_callBackPtr != NULL_PTR)
+	{
+		while(ticks != 0)
+		{
+			(*g_callBackPtr)();
+			ticks--;
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Function to enable the input capture on ICP1 (PD6):
+ * 1. ICP1 pin as input.
+ * 2. Noise canceler on, the edge must be stable for 4 timer clocks.
+ * 3. Select the capture edge, clear the old capture flag and enable the capture interrupt.
+ */
+void Timer1_enableInputCapture(Timer1_CaptureEdge edge)
+{
+	/* ICP1 is PD6 */
+	DDRD &= ~(1 << PD6);
+
+	TCCR1B |= (1 << ICNC1);
+	if (edge == CAPTURE_RISING_EDGE) {
+		TCCR1B |= (1 << ICES1);
+	}
+	else {
+		TCCR1B &= ~(1 << ICES1);
+	}
+
+	/* Changing ICES1 may set the flag, clear it by writing one */
+	TIFR = (1 << ICF1);
+	TIMSK |= (1 << TICIE1);
+}
@@ -27,6 +27,11 @@ typedef enum{
 	NORMAL_MODE, CTC_MODE=4
 }Timer1_Mode;
 
+/* ICP1 (PD6) edge that captures TCNT1 into ICR1 */
+typedef enum{
+	CAPTURE_FALLING_EDGE, CAPTURE_RISING_EDGE
+}Timer1_CaptureEdge;
+
 typedef struct {
 	uint16 initial_value;
 	uint16 compare_value; // it will be used in compare mode only.
@@ -52,9 +57,53 @@ void Timer1_deInit(void);
 
 /*
  * Description :
- * Function to set the call back function address
+ * Function to set the call back function address, it is not called from the ISR:
+ * the ISR only counts the ticks and Timer1_runPendingTicks calls it once for every tick
  */
 void Timer1_setCallBack(void(*a_ptr)(void));
 
+/*
+ * Description :
+ * Function to return the number of ticks (compare matches or overflows) counted by the ISR,
+ * it wraps after 65536 ticks
+ */
+uint16 Timer1_getTicks(void);
+
+/*
+ * Description :
+ * Function to run the call back once for every tick counted since the last call, from the main
+ * context. It returns FALSE without changing the global interrupts if no tick is pending,
+ * else it returns TRUE with the interrupts enabled.
+ */
+boolean Timer1_runPendingTicks(void);
+
+/*
+ * Description :
+ * Function to enable the input capture on ICP1 (PD6) with the noise canceler,
+ * Timer1 must be running (Timer1_init) and the ICR1 TOP modes are not supported.
+ * The TIMER1_CAPT_vect ISR belongs to the driver of the captured signal, it reads ICR1 inline.
+ */
+void Timer1_enableInputCapture(Timer1_CaptureEdge edge);
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+/* Ticks counted by the ISR, use Timer1_getTicks or Timer1_getTicksInline to read it */
+extern volatile uint16 g_timer1Ticks;
+
+/*******************************************************************************
+ *                              Inline Functions                               *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Inline version of Timer1_getTicks for the ISRs only, the global interrupts are already disabled
+ * so the 16-bit count is read without a call and without an atomic block.
+ */
+static inline __attribute__((always_inline)) uint16 Timer1_getTicksInline(void)
+{
+	return g_timer1Ticks;
+}
+
 
 #endif /* TIMER1_H_ */
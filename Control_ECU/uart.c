@@ -14,6 +14,35 @@
 #include "avr/io.h" /* To use the UART Registers */
 #include "avr/interrupt.h" /*To use the Interrupts*/
 #include "common_macros.h" /* To use the macros like SET_BIT */
+#include "power.h" /* To sleep while waiting for the received bytes */
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+
+/* Circular buffer filled by the Rx Complete ISR and emptied by UART_receiveByte */
+static volatile uint8 g_rxBuffer[UART_RX_BUFFER_SIZE];
+static volatile uint8 g_rxHead = 0; /* Next index written by the ISR */
+static volatile uint8 g_rxTail = 0; /* Next index read by the application */
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+/* UART Rx Complete ISR, it also wakes the CPU from the idle sleep */
+ISR(USART_RXC_vect)
+{
+	/* Reading UDR clears the RXC flag */
+	uint8 data = UDR;
+	uint8 nextHead = (g_rxHead + 1) & (UART_RX_BUFFER_SIZE - 1);
+
+	/* Drop the byte if the buffer is full */
+	if(nextHead != g_rxTail)
+	{
+		g_rxBuffer[g_rxHead] = data;
+		g_rxHead = nextHead;
+	}
+}
 
 /*******************************************************************************
  *                      Functions Definitions                                  *
@@ -34,14 +63,14 @@ void UART_init(const UART_ConfigType * Config_Ptr)
 	UCSRA = (1<<U2X);
 
 	/************************** UCSRB Description **************************
-	 * RXCIE = 0 Disable USART RX Complete Interrupt Enable
+	 * RXCIE = 1 Enable USART RX Complete Interrupt Enable
 	 * TXCIE = 0 Disable USART Tx Complete Interrupt Enable
 	 * UDRIE = 0 Disable USART Data Register Empty Interrupt Enable
 	 * RXEN  = 1 Receiver Enable
 	 * RXEN  = 1 Transmitter Enable
 	 * UCSZ2 = Configure bit data mode
 	 ***********************************************************************/ 
-	UCSRB = (1<<RXEN) | (1<<TXEN)| (GET_BIT(Config_Ptr->bit_data,2)<<2);
+	UCSRB = (1<<RXCIE) | (1<<RXEN) | (1<<TXEN)| (GET_BIT(Config_Ptr->bit_data,2)<<2);
 	/************************** UCSRC Description **************************
 	 * URSEL   = 1 The URSEL must be one when writing the UCSRC
 	 * UMSEL   = 0 Asynchronous Operation
@@ -89,18 +118,34 @@ void UART_sendByte(const uint8 data)
 /*
  * Description :
  * Functional responsible for receive byte from another UART device.
+ * The CPU sleeps in idle mode until the Rx Complete ISR stores a byte in the buffer.
  */
 uint8 UART_receiveByte(void)
 {
-	/* RXC flag is set when the UART receive data so wait until this flag is set to one */
-	while (BIT_IS_CLEAR(UCSRA, RXC)) {
+	uint8 data;
+
+	/* Check the buffer with interrupts disabled so the wake up byte can not be missed */
+	cli();
+	while(g_rxHead == g_rxTail)
+	{
+		Power_enterIdle();
+		cli();
 	}
+	sei();
 
-	/*
-	 * Read the received data from the Rx buffer (UDR)
-	 * The RXC flag will be cleared after read the data
-	 */
-    return UDR;
+	data = g_rxBuffer[g_rxTail];
+	g_rxTail = (g_rxTail + 1) & (UART_RX_BUFFER_SIZE - 1);
+	return data;
+}
+
+/*
+ * Description :
+ * Return TRUE if a received byte is waiting in the Rx buffer,
+ * so the caller can read it with UART_receiveByte without sleeping.
+ */
+boolean UART_isByteReceived(void)
+{
+	return (g_rxHead != g_rxTail) ? TRUE : FALSE;
 }
 
 /*
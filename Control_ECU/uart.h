@@ -17,9 +17,17 @@
 
 #define MC1_READY   	   0x10
 #define MC2_READY   	   0x20
+/* Door events sent by the Control ECU when a door reaches its position, plus the door number (0 -->) */
+#define DOOR_UNLOCKED      0x30
+#define DOOR_LOCKED        0x40
+/* Door move failed (worst case timeout or abandoned after stalls), plus the door number (0 -->) */
+#define DOOR_FAULT         0x50
 
 #define F_CPU 8000000UL
 
+/* Size of the received bytes buffer, it must be a power of 2 */
+#define UART_RX_BUFFER_SIZE   16
+
 /*******************************************************************************
  *                         Types Declaration                                   *
  *******************************************************************************/
@@ -85,9 +93,17 @@ void UART_sendByte(const uint8 data);
 /*
  * Description :
  * Functional responsible for receive byte from another UART device.
+ * The CPU sleeps in idle mode until the Rx Complete ISR stores a byte in the buffer.
  */
 uint8 UART_receiveByte(void);
 
+/*
+ * Description :
+ * Return TRUE if a received byte is waiting in the Rx buffer,
+ * so the caller can read it with UART_receiveByte without sleeping.
+ */
+boolean UART_isByteReceived(void);
+
 /*
  * Description :
  * Send the required string through UART to the other UART device.
@@ -0,0 +1,69 @@
+ /******************************************************************************
+ *
+ * Module: Work Queue
+ *
+ * File Name: work_queue.c
+ *
+ * Description: Source file for the deferred work queue, filled by the ISRs and run by the main context
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+#include "work_queue.h"
+#include <avr/interrupt.h> /* For sei */
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+/*
+ * Circular buffer of the work items, both indices are single bytes,
+ * so each side reads the other one atomically.
+ */
+WorkQueue_HandlerType g_workQueueHandlers[WORK_QUEUE_SIZE];
+uint8 g_workQueueArgs[WORK_QUEUE_SIZE];
+volatile uint8 g_workQueueHead = 0; /* Next index written by the producer */
+volatile uint8 g_workQueueTail = 0; /* Next index read by the consumer */
+
+/* Work items lost because the queue was full, saturated at 255 */
+volatile uint8 g_workQueueLostItems = 0;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Run the posted work items in order with the global interrupts enabled,
+ * called with them disabled so an empty queue is returned without enabling them.
+ * Every item is read before the tail moves, the producer never overwrites an item being read.
+ */
+boolean WorkQueue_runPending(void)
+{
+	uint8 tail = g_workQueueTail;
+	WorkQueue_HandlerType handler;
+	uint8 arg;
+
+	if(tail == g_workQueueHead)
+	{
+		return FALSE;
+	}
+	sei();
+	do
+	{
+		handler = g_workQueueHandlers[tail];
+		arg = g_workQueueArgs[tail];
+		tail = (tail + 1) & (WORK_QUEUE_SIZE - 1);
+		g_workQueueTail = tail;
+		(*handler)(arg);
+	} while(tail != g_workQueueHead);
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Return the number of work items lost because the queue was full.
+ */
+uint8 WorkQueue_getLostItems(void)
+{
+	return g_workQueueLostItems;
+}
@@ -0,0 +1,103 @@
+ /******************************************************************************
+ *
+ * Module: Work Queue
+ *
+ * File Name: work_queue.h
+ *
+ * Description: Header file for the deferred work queue, filled by the ISRs and run by the main context
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+
+#ifndef WORK_QUEUE_H_
+#define WORK_QUEUE_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+/*
+ * Number of work items the queue holds, a power of 2 so the indices wrap with a mask,
+ * one entry stays free to tell a full queue from an empty one.
+ * Every producer keeps at most one item of its own in the queue (it posts again only after its
+ * handler ran), so the 7 free entries are more than the producers:
+ * e-stop 1, encoder 1 per channel, current sense 1 per channel.
+ */
+#define WORK_QUEUE_SIZE                 8
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+/* Work item handler, run in the main context with its argument */
+typedef void (*WorkQueue_HandlerType)(uint8 arg);
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Run the posted work items in order, the consumer side of the queue.
+ * It must be called with the global interrupts disabled, like Power_enterIdle, so the caller
+ * can sleep right after an empty queue without missing a new item:
+ * - Empty queue: return FALSE with the interrupts still disabled.
+ * - Else enable the interrupts, run every item (also the ones posted meanwhile) and return TRUE.
+ * A work item handler must not wait in Power_enterIdle.
+ */
+boolean WorkQueue_runPending(void);
+
+/*
+ * Description :
+ * Return the number of work items lost because the queue was full.
+ */
+uint8 WorkQueue_getLostItems(void);
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+/*
+ * Circular buffer of the work items, only used through WorkQueue_postInline and WorkQueue_runPending:
+ * the head is only written by the producer (ISRs), after the item itself, and the tail only by
+ * the consumer (main context), after it read the item.
+ */
+extern WorkQueue_HandlerType g_workQueueHandlers[WORK_QUEUE_SIZE];
+extern uint8 g_workQueueArgs[WORK_QUEUE_SIZE];
+extern volatile uint8 g_workQueueHead;
+extern volatile uint8 g_workQueueTail;
+extern volatile uint8 g_workQueueLostItems;
+
+/*******************************************************************************
+ *                              Inline Functions                               *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Post a work item to be run later by the main context, it returns FALSE if the queue is full.
+ * Inlined in the ISRs so posting adds no call to their prologue. Lock free single producer:
+ * it must be called with the global interrupts disabled (an ISR, or an ATOMIC_BLOCK in the
+ * ISR_NOBLOCK call backs, so the producers never nest and together they are the one producer).
+ * The item is written before the head moves,
+ * the consumer never sees a half written item.
+ */
+static inline __attribute__((always_inline)) boolean WorkQueue_postInline(WorkQueue_HandlerType handler, uint8 arg)
+{
+	uint8 head = g_workQueueHead;
+	uint8 nextHead = (head + 1) & (WORK_QUEUE_SIZE - 1);
+
+	if(nextHead == g_workQueueTail)
+	{
+		if(g_workQueueLostItems != 0xFF)
+		{
+			g_workQueueLostItems++;
+		}
+		return FALSE;
+	}
+	g_workQueueHandlers[head] = handler;
+	g_workQueueArgs[head] = arg;
+	g_workQueueHead = nextHead;
+	return TRUE;
+}
+
+#endif /* WORK_QUEUE_H_ */
@@ -8,6 +8,7 @@ C_SRCS += \
 ../gpio.c \
 ../keypad.c \
 ../lcd.c \
+../power.c \
 ../timer1.c \
 ../uart.c 
 
@@ -16,6 +17,7 @@ OBJS += \
 ./gpio.o \
 ./keypad.o \
 ./lcd.o \
+./power.o \
 ./timer1.o \
 ./uart.o 
 
@@ -24,6 +26,7 @@ C_DEPS += \
 ./gpio.d \
 ./keypad.d \
 ./lcd.d \
+./power.d \
 ./timer1.d \
 ./uart.d 
 
@@ -15,12 +15,15 @@
  *******************************************************************************/
 #include "HMI_ECU.h"
 #include "avr/interrupt.h"
+#include "avr/pgmspace.h"
 #include "util/delay.h"
 #include "std_types.h"
 #include "timer1.h"
 #include "uart.h"
 #include "keypad.h"
 #include "lcd.h"
+#include "pt.h"
+#include "power.h"
 
 /*******************************************************************************
  *                           Global Variables                                  *
@@ -30,65 +33,148 @@ static uint8 g_password1[PASSWORD_SIZE];
 static uint8 g_password2[PASSWORD_SIZE];
 /* Global variable to represent the current state within the HMI system sequence */
 uint8 g_HMI_SYSTEM_SEQUENCE = CREATE_PASSWORD;
-/* Global variable for Timer1 interrupts counter */
-static uint8 g_tick = 0;
+/* Last byte received from the Control ECU */
+static uint8 g_receivedFrame = 0;
+/* Byte from the Control ECU that is not a door event, kept until a coroutine takes it */
+static uint8 g_pendingFrame = 0;
+static boolean g_isFramePending = FALSE;
+/* Door to open (0 --> NUMBER_OF_DOORS - 1), its events are the door events plus its number */
+static uint8 g_door = 0;
+/* Last event of every door (DOOR_UNLOCKED, DOOR_LOCKED or DOOR_FAULT), the doors are locked at reset */
+static uint8 g_doorEvents[NUMBER_OF_DOORS];
+
+/* Coroutines state, 4 bytes each */
+static PT_ThreadType g_sequenceThread; /* The HMI system sequence */
+static PT_ThreadType g_flowThread;     /* User flow started by the system sequence */
+static PT_ThreadType g_fillThread;     /* Password entry started by a user flow */
+
+/* UI messages, kept in flash so they are not copied to SRAM at startup */
+static const char g_msgEnter[] PROGMEM = "= : Enter";
+static const char g_msgCreateNew[] PROGMEM = "Create new";
+static const char g_msgPassword[] PROGMEM = "password";
+static const char g_msgEnterPass[] PROGMEM = "Plz enter pass:";
+static const char g_msgReEnter[] PROGMEM = "Plz re-enter the";
+static const char g_msgSamePass[] PROGMEM = "same pass: ";
+static const char g_msgOpenDoorOption[] PROGMEM = "+ : Open Door";
+static const char g_msgChangePassOption[] PROGMEM = "- : Change Pass";
+static const char g_msgSelectDoor[] PROGMEM = "Door number:";
+static const char g_msgEnterSaved[] PROGMEM = "Enter your saved ";
+static const char g_msgSavedPassword[] PROGMEM = "password:  ";
+static const char g_msgError[] PROGMEM = "ERROR!! YOU ARE";
+static const char g_msgNotAuthorized[] PROGMEM = "NOT AUTHORIZED";
+static const char g_msgPasswordSaved[] PROGMEM = "PASSWORD SAVED!";
+static const char g_msgUnlocking[] PROGMEM = "Unlocking door";
+static const char g_msgDoorFault[] PROGMEM = "Door fault!";
+static const char g_msgWelcomeBack[] PROGMEM = "Welcome Back!";
+static const char g_msgChangePassword[] PROGMEM = "Change Password";
+static const char g_msgDoorLocker[] PROGMEM = "Door Locker";
+static const char g_msgSecuritySystem[] PROGMEM = "Security System";
+
+/* Flash message table indexed by HMI_MessageType */
+static const char * const g_messages[NUMBER_OF_MESSAGES] PROGMEM = {
+	g_msgEnter,
+	g_msgCreateNew,
+	g_msgPassword,
+	g_msgEnterPass,
+	g_msgReEnter,
+	g_msgSamePass,
+	g_msgOpenDoorOption,
+	g_msgChangePassOption,
+	g_msgSelectDoor,
+	g_msgEnterSaved,
+	g_msgSavedPassword,
+	g_msgError,
+	g_msgNotAuthorized,
+	g_msgPasswordSaved,
+	g_msgUnlocking,
+	g_msgDoorFault,
+	g_msgWelcomeBack,
+	g_msgChangePassword,
+	g_msgDoorLocker,
+	g_msgSecuritySystem
+};
+/* Address in flash of a message from the message table, for the LCD _P functions */
+#define HMI_MESSAGE(id)         ((const char *)pgm_read_ptr(&g_messages[(id)]))
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
 
 /*
  * Description :
- * Private function to fill password arrays
+ * Return the system tick used by the coroutines timeout macros,
+ * the 16-bit counter of the Timer1 ISR (1 tick = 1 ms)
+ * */
+uint16 PT_getTick(void) {
+	return Timer1_getTicks();
+}
+
+/*
+ * Description :
+ * Take the byte received from the Control ECU for the coroutines wait macro,
+ * the door events are not returned, they are handled by receiveFrames
+ * */
+boolean PT_takeFrame(uint8 *frame) {
+	if (!g_isFramePending) {
+		return FALSE;
+	}
+	*frame = g_pendingFrame;
+	g_isFramePending = FALSE;
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Private coroutine to fill password arrays
  * its arguments are password size and the password array */
-static void fillPasswordArray(uint8 size, uint8 *array) {
+static PT_THREAD(fillPasswordArray(PT_ThreadType *pt, uint8 size, uint8 *array)) {
 	/*Loop Counter*/
-	uint8 i = 0;
+	static uint8 i;
 	/*Pressed Key*/
-	uint8 key = 0;
+	static uint8 key;
+
+	PT_BEGIN(pt);
+	i = 0;
 	/*Loop to fill password array */
 	while (i < size) {
-		/* Get the pressed key number,
-		 * if any switch pressed for more than 500ms it will considered more than one press */
-		key = KEYPAD_getPressedKey();
-		if ((key >= 0) && (key <= 9)) {
+		/* Get the next pressed key from the keypad events, each press is one event */
+		PT_WAIT_UNTIL(pt, KEYPAD_getKeyPress(&key));
+		if (key <= 9) {
 			array[i] = key;
-			LCD_displayCharacter('*');
+			LCD_FB_displayCharacter('*');
 			i++;
 		}
-		_delay_ms(500);
-	}
-	_delay_ms(100);
-	LCD_clearScreen();
-	LCD_displayString("= : Enter");
-	/*wait using polling technique until the user press the Enter*/
-	while (KEYPAD_getPressedKey() != ENTER) {
 	}
-	_delay_ms(500);
-	LCD_clearScreen();
-	return;
+	PT_WAIT_TIMEOUT(pt, 100);
+	LCD_FB_clearScreen();
+	LCD_FB_displayString_P(HMI_MESSAGE(MSG_ENTER));
+	/*wait until the user press the Enter*/
+	PT_WAIT_UNTIL(pt, KEYPAD_getKeyPress(&key) && (key == ENTER));
+	LCD_FB_clearScreen();
+	PT_END(pt);
 }
 
 /*
  * Description :
- * Function to create the system password
+ * Coroutine to create the system password
  * */
-void createPassword(void) {
-	LCD_displayString("Create new");
-	LCD_displayStringRowColumn(1, 0, "password");
+PT_THREAD(createPassword(PT_ThreadType *pt)) {
+	PT_BEGIN(pt);
+	LCD_FB_displayString_P(HMI_MESSAGE(MSG_CREATE_NEW));
+	LCD_FB_displayStringRowColumn_P(1, 0, HMI_MESSAGE(MSG_PASSWORD));
 
-	_delay_ms(1000);
-	LCD_clearScreen();
-	LCD_displayString("Plz enter pass:");
-	LCD_moveCursor(1, 0);
-	fillPasswordArray(PASSWORD_SIZE, g_password1);
-
-	_delay_ms(500);
-	LCD_clearScreen();
-	LCD_displayString("Plz re-enter the");
-	LCD_displayStringRowColumn(1, 0, "same pass: ");
-	fillPasswordArray(PASSWORD_SIZE, g_password2);
-	LCD_clearScreen();
+	PT_WAIT_TIMEOUT(pt, 1000);
+	LCD_FB_clearScreen();
+	LCD_FB_displayString_P(HMI_MESSAGE(MSG_ENTER_PASS));
+	LCD_FB_moveCursor(1, 0);
+	PT_SPAWN(pt, &g_fillThread, fillPasswordArray(&g_fillThread, PASSWORD_SIZE, g_password1));
 
+	PT_WAIT_TIMEOUT(pt, 500);
+	LCD_FB_clearScreen();
+	LCD_FB_displayString_P(HMI_MESSAGE(MSG_RE_ENTER));
+	LCD_FB_displayStringRowColumn_P(1, 0, HMI_MESSAGE(MSG_SAME_PASS));
+	PT_SPAWN(pt, &g_fillThread, fillPasswordArray(&g_fillThread, PASSWORD_SIZE, g_password2));
+	LCD_FB_clearScreen();
+	PT_END(pt);
 }
 
 /*
@@ -106,24 +192,94 @@ void sendPassword(uint8 size, uint8 *password) {
 
 /*
  * Description :
- * Private function to display the main options on an LCD
+ * Private function to display the status glyph of a door at the end of the first row,
+ * or the fault character if its last move failed
+ * */
+static void displayDoorStatus(uint8 door) {
+	LCD_FB_moveCursor(0, LCD_COLS - NUMBER_OF_DOORS + door);
+	if (g_doorEvents[door] == DOOR_FAULT) {
+		LCD_FB_displayCharacter(DOOR_FAULT_CHARACTER);
+	} else {
+		LCD_FB_displayCharacter(LCD_FB_setGlyph(DOOR_STATUS_FIRST_SLOT + door,
+				(g_doorEvents[door] == DOOR_LOCKED) ? LCD_GLYPH_LOCK : LCD_GLYPH_UNLOCK));
+	}
+}
+
+/*
+ * Description :
+ * Private function to display the main options on an LCD with the doors status
  * */
 static void displayMainOptions(void) {
-	LCD_displayString("+ : Open Door");
-	LCD_displayStringRowColumn(1, 0, "- : Change Pass");
+	uint8 door;
+
+	LCD_FB_displayString_P(HMI_MESSAGE(MSG_OPEN_DOOR_OPTION));
+	LCD_FB_displayStringRowColumn_P(1, 0, HMI_MESSAGE(MSG_CHANGE_PASS_OPTION));
+	for (door = 0; door < NUMBER_OF_DOORS; door++) {
+		displayDoorStatus(door);
+	}
+}
+
+/*
+ * Description :
+ * Private function to check that every door sent its lock event,
+ * a faulty door keeps the panel awake to show its fault
+ * */
+static boolean areDoorsLocked(void) {
+	uint8 door;
+
+	for (door = 0; door < NUMBER_OF_DOORS; door++) {
+		if (g_doorEvents[door] != DOOR_LOCKED) {
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * Description :
+ * Private function run from the scheduler loop, the only reader of the UART:
+ * the door events are sent by the Control ECU whenever a door sequence moves on,
+ * so they are taken out of the stream, saved and shown on the main options at once.
+ * Any other byte is kept for the coroutines, the next bytes wait in the UART until it is taken.
+ * */
+static void receiveFrames(void) {
+	uint8 frame;
+	uint8 door;
+
+	while (!g_isFramePending && UART_isByteReceived()) {
+		frame = UART_receiveByte();
+		door = frame & 0x0F;
+		if ((((frame & 0xF0) == DOOR_UNLOCKED) || ((frame & 0xF0) == DOOR_LOCKED)
+				|| ((frame & 0xF0) == DOOR_FAULT)) && (door < NUMBER_OF_DOORS)) {
+			g_doorEvents[door] = frame & 0xF0;
+			if (g_HMI_SYSTEM_SEQUENCE == MAIN_OPTIONS) {
+				displayDoorStatus(door);
+			}
+		} else {
+			g_pendingFrame = frame;
+			g_isFramePending = TRUE;
+		}
+	}
 }
 
 /*
  * Description :
- * Function to allow the user to choose between opening the door
+ * Coroutine to allow the user to choose between opening the door
  * or changing the password based on keypad input
  * */
-void takeChoice(void) {
-	uint8 choice = 0;
-	/* Get the pressed key number,
-	 * if any switch pressed for more than 250ms it will considered more than one press */
+PT_THREAD(takeChoice(PT_ThreadType *pt)) {
+	static uint8 choice;
+
+	PT_BEGIN(pt);
+	choice = 0;
 	while (choice != '+' && choice != '-') {
-		choice = KEYPAD_getPressedKey();
+		PT_WAIT_UNTIL_OR_TIMEOUT(pt, KEYPAD_getKeyPress(&choice) && ((choice == '+') || (choice == '-')),
+				PANEL_IDLE_TIME_MS);
+		if ((choice != '+') && (choice != '-') && areDoorsLocked()) {
+			/* The panel is idle, sleep until any key is pressed, the UART does not
+			 * run in power-down so the HMI ECU stays awake until every door is locked */
+			Power_enterPowerDown();
+		}
 	}
 	if (choice == '+') {
 		g_HMI_SYSTEM_SEQUENCE = OPEN_DOOR;
@@ -131,194 +287,256 @@ void takeChoice(void) {
 		g_HMI_SYSTEM_SEQUENCE = CHANGE_PASSWORD;
 	}
 	UART_sendByte(g_HMI_SYSTEM_SEQUENCE);
+	PT_END(pt);
+}
+/*
+ * Description :
+ * Private coroutine to select the door to open with the keys 1 --> NUMBER_OF_DOORS,
+ * the door number is sent to the Control ECU before the password
+ * */
+static PT_THREAD(selectDoor(PT_ThreadType *pt)) {
+	static uint8 key;
+
+	PT_BEGIN(pt);
+	LCD_FB_clearScreen();
+	LCD_FB_displayString_P(HMI_MESSAGE(MSG_SELECT_DOOR));
+	PT_WAIT_UNTIL(pt, KEYPAD_getKeyPress(&key) && (key >= 1) && (key <= NUMBER_OF_DOORS));
+	LCD_FB_displayCharacter('0' + key);
+	g_door = key - 1;
+	UART_sendByte(g_door);
+	PT_WAIT_TIMEOUT(pt, 300);
+	PT_END(pt);
 }
+
 /*
  * Description :
- * Function allows the user to input the created password
+ * Coroutine allows the user to input the created password
  * sends the password to the Control ECU to check it
  * */
-void enterPassword(void) {
-	uint8 userPassword[PASSWORD_SIZE];
-	LCD_clearScreen();
-	LCD_displayString("Enter your saved ");
-	LCD_displayStringRowColumn(1,0,"password:  ");
-	fillPasswordArray(PASSWORD_SIZE, userPassword);
-	while (UART_receiveByte() != MC1_READY) {
-	};
+PT_THREAD(enterPassword(PT_ThreadType *pt)) {
+	static uint8 userPassword[PASSWORD_SIZE];
+
+	PT_BEGIN(pt);
+	LCD_FB_clearScreen();
+	LCD_FB_displayString_P(HMI_MESSAGE(MSG_ENTER_SAVED));
+	LCD_FB_displayStringRowColumn_P(1, 0, HMI_MESSAGE(MSG_SAVED_PASSWORD));
+	PT_SPAWN(pt, &g_fillThread, fillPasswordArray(&g_fillThread, PASSWORD_SIZE, userPassword));
+	do {
+		PT_WAIT_UART_FRAME(pt, g_receivedFrame);
+	} while (g_receivedFrame != MC1_READY);
 	sendPassword(PASSWORD_SIZE, userPassword);
+	PT_END(pt);
 }
 /* Description :
- * Callback function for timer1 to control the LCD messages displaying time
+ * Callback function for timer1 run from the scheduler loop once for every system tick
+ * counted by the Timer1 ISR, to scan the keypad and to refresh the LCD.
+ * The ticks counted while a coroutine step was busy are run back to back with the same Timer1
+ * tick count: only the first of them does the work, and the keypad scans are timed with the
+ * tick count, so a burst never runs the debounce scans less than KEYPAD_SCAN_PERIOD_MS apart
  */
 void controlMessageTime(void) {
-	g_tick++;
+	static uint16 lastTick = 0;
+	static uint16 lastScanTick = 0;
+	uint16 tick = Timer1_getTicks();
+
+	if (tick == lastTick) {
+		return;
+	}
+	lastTick = tick;
+	/* Run the keypad scan task every KEYPAD_SCAN_PERIOD_MS */
+	if ((uint16)(tick - lastScanTick) >= KEYPAD_SCAN_PERIOD_MS) {
+		lastScanTick = tick;
+		KEYPAD_scanTask();
+		Power_keypadTask();
+	}
+	/* Stream the frame buffer changes to the LCD in the background */
+	LCD_FB_refreshTask();
 }
 /*
  * Description :
- * Function to display an error message for 1 Minute
+ * Coroutine to display an error message for 1 Minute
  * */
-void displayError(void) {
-	/* Timer1 Configuration
-	 * ---------------------
-	 * F_Timer = 8MHz/1024(from Pre-scaler) = 7812 Hz
-	 * T_Timer = 1/7812 = 128usec
-	 * T_Compare = Compare Value * 128usec
-	 * As I need 8 interrupts ( 8 compare matches ) per 60 second, so T_Compare = 60/8
-	 * 60/8 = Compare Value * 128usec
-	 * Compare Value = 7.5/128usec = 58594
-	 * Compare Value = 58594
-	 */
-	Timer1_ConfigType TimerConfiguration =
-	{ 0, 58594, PRESCALER_1024, CTC_MODE };
-	Timer1_setCallBack(controlMessageTime);
-	Timer1_init(&TimerConfiguration);
-	while (g_tick < 8) {};
-	g_tick = 0; /* Reset the interrupts counter */
-	Timer1_deInit(); /* Reset timer1 registers */
+PT_THREAD(displayError(PT_ThreadType *pt)) {
+	PT_BEGIN(pt);
+	PT_WAIT_TIMEOUT(pt, ERROR_MESSAGE_TIME_MS);
 
 	/*Go to Main Options again*/
-	LCD_clearScreen();
+	LCD_FB_clearScreen();
+	PT_END(pt);
 }
-/*******************************************************************************
- *                          MAIN FUNCTION                                      *
- *******************************************************************************/
 
-int main(void) {
+/*
+ * Description :
+ * Coroutine to check the user password with the Control ECU,
+ * it displays the error message if the password is not matched for a number of consecutive times
+ * */
+static PT_THREAD(verifyPassword(PT_ThreadType *pt)) {
 	/*Variable to count the number of consecutive failures of entering the password*/
-	uint8 failuresCounter = 0;
-	/* Enable Global Interrupt */
-	SREG |= (1 << 7);
-	/* LCD Initialization */
-	LCD_init();
+	static uint8 failuresCounter = 0;
 
-	/* Welcome Message */
-	LCD_displayString("Door Locker");
-	LCD_displayStringRowColumn(1, 0, "Security System");
-	_delay_ms(1000);
-	LCD_clearScreen();
+	PT_BEGIN(pt);
+	do {
+		if (failuresCounter < NUMBER_OF_CONSECUTIVE_FAILURES) {
+			PT_SPAWN(pt, &g_flowThread, enterPassword(&g_flowThread));
+			PT_WAIT_TIMEOUT(pt, 10);
+			failuresCounter++;
+		} else {
+			/* ERROR Message */
+			LCD_FB_displayString_P(HMI_MESSAGE(MSG_ERROR));
+			LCD_FB_displayStringRowColumn_P(1, 0, HMI_MESSAGE(MSG_NOT_AUTHORIZED));
+			PT_SPAWN(pt, &g_flowThread, displayError(&g_flowThread));
+			LCD_FB_clearScreen();
+			/*Return to the main options after error occurs*/
+			g_HMI_SYSTEM_SEQUENCE = MAIN_OPTIONS;
+		}
+		PT_WAIT_UART_FRAME(pt, g_receivedFrame);
+	} while (g_receivedFrame != PASSWORDS_MATCHED);
+	failuresCounter = 0;
+	PT_END(pt);
+}
 
-	/* UART Configuration */
-	UART_ConfigType UART_Configuration = { EIGHT_BITS_DATA, DISABLED,
-			ONE_STOP_BIT, BAUD_RATE_9600_BPS };
-	/* UART Initialization */
-	UART_init(&UART_Configuration);
+/*
+ * Description :
+ * Coroutine to show the door unlocking until the Control ECU sends the unlock or fault event of the door,
+ * the message and the unlock glyph on the first row and a progress bar on the second row updated
+ * every DOOR_PROGRESS_STEP_MS. The bar follows the expected unlocking time and waits on its last step
+ * if the door is slower, it is filled when the unlock event comes. The events are received by receiveFrames,
+ * the last event of the door is cleared first so a new event is waited for.
+ * */
+static PT_THREAD(doorProgress(PT_ThreadType *pt, uint8 door)) {
+	/* Time shown by the progress bar, kept between the waits */
+	static uint16 elapsed;
 
-	while (1) {
-		switch (g_HMI_SYSTEM_SEQUENCE) {
+	PT_BEGIN(pt);
+	LCD_FB_clearScreen();
+	LCD_FB_displayString_P(HMI_MESSAGE(MSG_UNLOCKING));
+	LCD_FB_moveCursor(0, LCD_COLS - 1);
+	LCD_FB_displayCharacter(LCD_FB_setGlyph(DOOR_GLYPH_SLOT, LCD_GLYPH_UNLOCK));
+	elapsed = 0;
+	g_doorEvents[door] = DOOR_EVENT_NONE;
+	while ((g_doorEvents[door] != DOOR_UNLOCKED) && (g_doorEvents[door] != DOOR_FAULT)) {
+		LCD_FB_displayProgressBar(1, 0, LCD_COLS, elapsed, DOOR_UNLOCKING_TIME_MS);
+		PT_WAIT_UNTIL_OR_TIMEOUT(pt, (g_doorEvents[door] == DOOR_UNLOCKED) || (g_doorEvents[door] == DOOR_FAULT),
+				DOOR_PROGRESS_STEP_MS);
+		if ((elapsed + DOOR_PROGRESS_STEP_MS) < DOOR_UNLOCKING_TIME_MS) {
+			elapsed += DOOR_PROGRESS_STEP_MS;
+		}
+	}
+	if (g_doorEvents[door] == DOOR_UNLOCKED) {
+		LCD_FB_displayProgressBar(1, 0, LCD_COLS, DOOR_UNLOCKING_TIME_MS, DOOR_UNLOCKING_TIME_MS);
+	}
+	PT_END(pt);
+}
+
+/*
+ * Description :
+ * Coroutine to run the HMI system sequence, one state per loop
+ * The states use if/else instead of switch as the coroutine itself is a switch
+ * */
+static PT_THREAD(systemSequence(PT_ThreadType *pt)) {
+	static PT_ThreadType stepThread; /* Step started by the current state */
 
-		case CREATE_PASSWORD:
+	PT_BEGIN(pt);
+	while (1) {
+		if (g_HMI_SYSTEM_SEQUENCE == CREATE_PASSWORD) {
 			/* To create and verify a password by collecting two passwords from the user
 			 * and sends them through UART to the Control ECU for comparison
 			 * if they matched, the Control ECU will save it in the EEPROM
 			 * if they not matched, the HMI ECU keep asking the user to create new password
 			 * */
 			do {
-				createPassword();
+				PT_SPAWN(pt, &g_flowThread, createPassword(&g_flowThread));
 				sendPassword(PASSWORD_SIZE, g_password1);
 				sendPassword(PASSWORD_SIZE, g_password2);
-			} while (UART_receiveByte() != PASSWORDS_MATCHED);
-			LCD_displayString("PASSWORD SAVED!");
-			_delay_ms(500);
-			LCD_clearScreen();
+				PT_WAIT_UART_FRAME(pt, g_receivedFrame);
+			} while (g_receivedFrame != PASSWORDS_MATCHED);
+			LCD_FB_displayString_P(HMI_MESSAGE(MSG_PASSWORD_SAVED));
+			PT_WAIT_TIMEOUT(pt, 500);
+			LCD_FB_clearScreen();
 			g_HMI_SYSTEM_SEQUENCE = MAIN_OPTIONS;
-			break;
-		case MAIN_OPTIONS:
+		} else if (g_HMI_SYSTEM_SEQUENCE == MAIN_OPTIONS) {
 			displayMainOptions();
-			takeChoice(); /*That choice determines the next state of the system*/
-			break;
-		case OPEN_DOOR:
-			do {
-				if (failuresCounter < NUMBER_OF_CONSECUTIVE_FAILURES) {
-					enterPassword();
-					_delay_ms(10);
-					failuresCounter++;
-				} else {
-					/* ERROR Message */
-					LCD_displayString("ERROR!! YOU ARE");
-					LCD_displayStringRowColumn(1, 0, "NOT AUTHORIZED");
-					displayError();
-					LCD_clearScreen();
-					/*Return to the main options after error occurs*/
-					g_HMI_SYSTEM_SEQUENCE = MAIN_OPTIONS;
-				}
-			} while (UART_receiveByte() != PASSWORDS_MATCHED);
-			failuresCounter=0;
-			/*Timer1 Configuration
-			 * ---------------------
-			 * F_Timer = 8MHz/1024(from Pre-scaler) = 7812 Hz
-			 * T_Timer = 1/7812 = 128usec
-			 * T_Compare = Compare Value * 128usec
-			 * As I need two interrupts ( two compare matches ) per 15 second, so T_Compare = 15/2
-			 * 15/2 = Compare Value * 128usec
-			 * Compare Value = 7.5/128usec = 58594
-			 * Compare Value = 58594
-			 * */
-			Timer1_ConfigType TimerConfiguration1 = { 0, 58594, PRESCALER_1024,
-					CTC_MODE };
-			Timer1_setCallBack(controlMessageTime);
-			Timer1_init(&TimerConfiguration1);
-
-			LCD_clearScreen();
-			LCD_displayString("Door is");
-			LCD_displayStringRowColumn(1, 0, "Unlocking..");
-
-			while (g_tick < 2){};
-			g_tick = 0; /*Reset the interrupts counter*/
-			Timer1_deInit(); /* Reset timer1 registers*/
-			/*For holding the door 3 seconds, we need to re-configure Timer1
-			 * Compare Value = 23438*/
-
-			Timer1_ConfigType TimerConfiguration2 = { 0, 23438, PRESCALER_1024,
-					CTC_MODE };
-			Timer1_setCallBack(controlMessageTime);
-			Timer1_init(&TimerConfiguration2);
-
-			LCD_clearScreen();
-			LCD_displayString("Welcome Back!");
-
-			while (g_tick < 1){};
-			g_tick = 0; /*Reset the interrupts counter*/
-			Timer1_deInit(); /*Reset timer1 registers*/
-
-			/*We need to reconfigure timer1 to wait 15 seconds door locking time*/
-			Timer1_ConfigType TimerConfiguration3 = { 0, 58594, PRESCALER_1024,
-					CTC_MODE };
-			Timer1_setCallBack(controlMessageTime);
-			Timer1_init(&TimerConfiguration3);
-
-			LCD_clearScreen();
-			LCD_displayString("Door is");
-			LCD_displayStringRowColumn(1, 0, "locking..");
-
-			while (g_tick < 2) {};
-			g_tick = 0; /*Reset the interrupts counter*/
-			Timer1_deInit(); /*Reset timer1 registers*/
-			LCD_clearScreen();
+			/*That choice determines the next state of the system*/
+			PT_SPAWN(pt, &stepThread, takeChoice(&stepThread));
+		} else if (g_HMI_SYSTEM_SEQUENCE == OPEN_DOOR) {
+			PT_SPAWN(pt, &g_flowThread, selectDoor(&g_flowThread));
+			PT_SPAWN(pt, &stepThread, verifyPassword(&stepThread));
+
+			PT_SPAWN(pt, &g_flowThread, doorProgress(&g_flowThread, g_door));
+
+			/* The Control ECU holds and locks the door by itself, its lock event is shown on the
+			 * main options so the other door can be opened meanwhile. A door that failed
+			 * to unlock is shown as faulty instead */
+			LCD_FB_clearScreen();
+			if (g_doorEvents[g_door] == DOOR_FAULT) {
+				LCD_FB_displayString_P(HMI_MESSAGE(MSG_DOOR_FAULT));
+			} else {
+				LCD_FB_displayString_P(HMI_MESSAGE(MSG_WELCOME_BACK));
+			}
+			PT_WAIT_TIMEOUT(pt, DOOR_WELCOME_TIME_MS);
+			LCD_FB_clearScreen();
 			g_HMI_SYSTEM_SEQUENCE = MAIN_OPTIONS;
-			break;
-		case CHANGE_PASSWORD:
-			do {
-				if (failuresCounter < NUMBER_OF_CONSECUTIVE_FAILURES) {
-					enterPassword();
-					_delay_ms(10);
-					failuresCounter++;
-				} else {
-					/* ERROR Message */
-					LCD_displayString("ERROR!! YOU ARE");
-					LCD_displayStringRowColumn(1, 0, "NOT AUTHORIZED");
-					displayError();
-					LCD_clearScreen();
-					/*Return to the main options after error occurs*/
-					g_HMI_SYSTEM_SEQUENCE = MAIN_OPTIONS;
-				}
-			} while (UART_receiveByte() != PASSWORDS_MATCHED);
-			failuresCounter=0;
-			LCD_displayString("Change Password");
-			_delay_ms(1000);
-			LCD_clearScreen();
+		} else if (g_HMI_SYSTEM_SEQUENCE == CHANGE_PASSWORD) {
+			PT_SPAWN(pt, &stepThread, verifyPassword(&stepThread));
+			LCD_FB_displayString_P(HMI_MESSAGE(MSG_CHANGE_PASSWORD));
+			PT_WAIT_TIMEOUT(pt, 1000);
+			LCD_FB_clearScreen();
 			/*REPEAT STEP 1*/
 			g_HMI_SYSTEM_SEQUENCE = CREATE_PASSWORD;
-			break;
 		}
 	}
+	PT_END(pt);
+}
+/*******************************************************************************
+ *                          MAIN FUNCTION                                      *
+ *******************************************************************************/
+
+int main(void) {
+	uint8 door;
+	/* Enable Global Interrupt */
+	SREG |= (1 << 7);
+	/* LCD Initialization */
+	LCD_init();
+
+	/* Welcome Message */
+	LCD_FB_displayString_P(HMI_MESSAGE(MSG_DOOR_LOCKER));
+	LCD_FB_displayStringRowColumn_P(1, 0, HMI_MESSAGE(MSG_SECURITY_SYSTEM));
+	LCD_FB_flush();
+	_delay_ms(1000);
+	LCD_FB_clearScreen();
+
+	/* UART Configuration */
+	UART_ConfigType UART_Configuration = { EIGHT_BITS_DATA, DISABLED,
+			ONE_STOP_BIT, BAUD_RATE_9600_BPS };
+	/* UART Initialization */
+	UART_init(&UART_Configuration);
+
+	/* Timer1 Configuration
+	 * ---------------------
+	 * F_Timer = 8MHz/64(from Pre-scaler) = 125 KHz
+	 * T_Timer = 1/125KHz = 8usec
+	 * T_Compare = (Compare Value + 1) * 8usec
+	 * As I need one interrupt per 1 msec (the system tick)
+	 * Compare Value = (1msec/8usec) - 1 = 124
+	 * The ISR only counts the ticks, controlMessageTime runs from the scheduler loop
+	 */
+	Timer1_ConfigType TimerConfiguration = { 0, SYSTEM_TICK_COMPARE_VALUE,
+			PRESCALER_64, CTC_MODE };
+	Timer1_setCallBack(controlMessageTime);
+	Timer1_init(&TimerConfiguration);
+
+	/* The doors are locked at reset */
+	for (door = 0; door < NUMBER_OF_DOORS; door++) {
+		g_doorEvents[door] = DOOR_LOCKED;
+	}
+
+	/* Run the system sequence coroutine forever, the screen changes it makes
+	 * are sent to the LCD by the system tick callback, the bytes of the Control ECU
+	 * are received between its steps */
+	PT_INIT(&g_sequenceThread);
+	while (1) {
+		systemSequence(&g_sequenceThread);
+		receiveFrames();
+		Timer1_runPendingTicks();
+	}
 }
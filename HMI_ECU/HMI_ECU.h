@@ -13,6 +13,8 @@
 #ifndef HMI_ECU_H_
 #define HMI_ECU_H_
 
+#include "pt.h"
+
 /*******************************************************************************
  *                                Definitions                                  *
  *******************************************************************************/
@@ -24,54 +26,110 @@
 #define PASSWORDS_UNMATCHED			   	 0
 #define PASSWORDS_MATCHED				 1
 #define NUMBER_OF_CONSECUTIVE_FAILURES   3
+/* Doors of the Control ECU, selected with the keys 1 --> NUMBER_OF_DOORS */
+#define NUMBER_OF_DOORS                  2
+
+/* Timer1 System Tick, one compare match per 1 ms */
+#define SYSTEM_TICK_COMPARE_VALUE       124
+
+/* Waiting Times in system ticks (ms) */
+/* Expected door unlocking time for the progress bar, the move ends with the Control ECU event */
+#define DOOR_UNLOCKING_TIME_MS          3800
+/* Welcome message time once the door is unlocked, then the main options are shown again */
+#define DOOR_WELCOME_TIME_MS            1000
+#define ERROR_MESSAGE_TIME_MS           60000
+/* Door phases progress bar update period */
+#define DOOR_PROGRESS_STEP_MS           200
+/* LCD CGRAM slot of the lock/unlock glyph shown during the door phases */
+#define DOOR_GLYPH_SLOT                 0
+/*
+ * LCD CGRAM slots of the doors status glyphs (one per door), shown at the end of the
+ * first row of the main options: locked, or unlocked from the unlock event until the lock event.
+ * A faulty door (DOOR_FAULT event) shows DOOR_FAULT_CHARACTER instead until its next event.
+ */
+#define DOOR_STATUS_FIRST_SLOT          1
+#define DOOR_FAULT_CHARACTER            '!'
+/* Door event value while the HMI ECU waits for the unlock event of the opened door */
+#define DOOR_EVENT_NONE                 0x00
+/* Time without a choice at the main options before the HMI ECU enters power-down */
+#define PANEL_IDLE_TIME_MS              30000
 
-/* Timer1 Waiting Times */
-#define HOLD_DOOR
 /*Human Machine Interface System Sequence*/
 #define CREATE_PASSWORD		    2
 #define MAIN_OPTIONS			3
 #define OPEN_DOOR				4
 #define CHANGE_PASSWORD			5
 
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+/* Index of every UI message in the flash message table */
+typedef enum {
+	MSG_ENTER,
+	MSG_CREATE_NEW,
+	MSG_PASSWORD,
+	MSG_ENTER_PASS,
+	MSG_RE_ENTER,
+	MSG_SAME_PASS,
+	MSG_OPEN_DOOR_OPTION,
+	MSG_CHANGE_PASS_OPTION,
+	MSG_SELECT_DOOR,
+	MSG_ENTER_SAVED,
+	MSG_SAVED_PASSWORD,
+	MSG_ERROR,
+	MSG_NOT_AUTHORIZED,
+	MSG_PASSWORD_SAVED,
+	MSG_UNLOCKING,
+	MSG_DOOR_FAULT,
+	MSG_WELCOME_BACK,
+	MSG_CHANGE_PASSWORD,
+	MSG_DOOR_LOCKER,
+	MSG_SECURITY_SYSTEM,
+	NUMBER_OF_MESSAGES
+}HMI_MessageType;
+
 /*******************************************************************************
  *                      Functions Prototypes                                   *
  *******************************************************************************/
 
 /*
  * Description :
- * Function to create the system password
+ * Coroutine to create the system password
  * */
-void createPassword(void);
+PT_THREAD(createPassword(PT_ThreadType *pt));
 
 /*
  * Description :
- * Function to send the system password to the Control ECU through the UART
+ * Function to send an array of bytes (a password) through UART to the Control ECU
  * */
+void sendPassword(uint8 size, uint8 *password);
+
 /*
  * Description :
- * Function to allow the user to choose between opening the door
+ * Coroutine to allow the user to choose between opening the door
  * or changing the password based on keypad input
  * */
-void takeChoice(void);
+PT_THREAD(takeChoice(PT_ThreadType *pt));
 
 /*
  * Description :
- * Function to allow the user to input the created password
+ * Coroutine to allow the user to input the created password
  * sends the password to the Control ECU to check it
  * */
-void enterPassword(void);
+PT_THREAD(enterPassword(PT_ThreadType *pt));
 
 /*
  * Description :
- * Callback function for timer1 to control the LCD messages displaying time
+ * Callback function for timer1 run from the scheduler loop for every system tick,
+ * to scan the keypad and to refresh the LCD once per new Timer1 tick count
  * */
 void controlMessageTime(void);
 
 /*
  * Description :
- * Function to display an error message for 1 Minute
+ * Coroutine to display an error message for 1 Minute
  * */
-void displayError(void);
+PT_THREAD(displayError(PT_ThreadType *pt));
 
 
 #endif /* HMI_ECU_H_ */
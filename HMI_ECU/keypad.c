@@ -11,160 +11,480 @@
  *******************************************************************************/
 #include "keypad.h"
 #include "gpio.h"
+#include <avr/pgmspace.h> /* For the key map tables in flash */
+#include <avr/interrupt.h> /* To read the scan task counters atomically */
 #include <util/delay.h>
+
 /*******************************************************************************
- *                      Functions Prototypes(Private)                          *
+ *                         Preprocessor Macros (Private)                       *
  *******************************************************************************/
+/* Keypad rows and columns pins masks in their ports */
+#define KEYPAD_ROWS_MASK     ((uint8)(((1 << KEYPAD_NUM_ROWS) - 1) << KEYPAD_FIRST_ROW_PIN_ID))
+#define KEYPAD_COLS_MASK     ((uint8)(((1 << KEYPAD_NUM_COLS) - 1) << KEYPAD_FIRST_COL_PIN_ID))
 
-#ifndef STANDARD_KEYPAD
-
-#if (KEYPAD_NUM_COLS == 3)
 /*
- * Function responsible for mapping the switch number in the keypad to
- * its corresponding functional number in the proteus for 4x3 keypad
+ * Port-wide fast scan: if the rows and the columns share the same port, every row step
+ * is one DDR write and one PIN read instead of one GPIO access per pin.
+ * Scattered wiring falls back to the GPIO inline pin functions.
  */
-static uint8 KEYPAD_4x3_adjustKeyNumber(uint8 button_number);
-#elif (KEYPAD_NUM_COLS == 4)
+#if (KEYPAD_ROW_PORT_ID == KEYPAD_COL_PORT_ID)
+#define KEYPAD_FAST_SCAN
+#define KEYPAD_DDR_REG       GPIO_DDR_REG(KEYPAD_ROW_PORT_ID)
+#define KEYPAD_PIN_REG       GPIO_PIN_REG(KEYPAD_ROW_PORT_ID)
+#endif
+
+/*******************************************************************************
+ *                         Types Declaration (Private)                         *
+ *******************************************************************************/
+/* Debounce state machine states of every key */
+typedef enum {
+	KEYPAD_KEY_RELEASED, KEYPAD_KEY_PRESS_DEBOUNCE, KEYPAD_KEY_PRESSED, KEYPAD_KEY_RELEASE_DEBOUNCE
+}KEYPAD_KeyState;
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+/* Debounce state and stable scans counter of every key, indexed by (row * KEYPAD_NUM_COLS) + col */
+static KEYPAD_KeyState g_keyState[KEYPAD_NUM_KEYS];
+static uint8 g_keyCounter[KEYPAD_NUM_KEYS];
+
 /*
- * Function responsible for mapping the switch number in the keypad to
- * its corresponding functional number in the proteus for 4x4 keypad
+ * Typeahead buffer: key events FIFO in the order the keys were pressed,
+ * filled by KEYPAD_scanTask (system tick) and emptied by KEYPAD_getEvent (application)
  */
-static uint8 KEYPAD_4x4_adjustKeyNumber(uint8 button_number);
+static volatile KEYPAD_EventType g_eventFifo[KEYPAD_TYPEAHEAD_SIZE];
+static volatile uint8 g_eventHead = 0; /* Next index written by the scan task */
+static volatile uint8 g_eventTail = 0; /* Next index read by the application */
+
+/* Rejected scans and dropped events counters */
+static volatile KEYPAD_DiagnosticsType g_diagnostics = { 0, 0, 0 };
+
+/* Debounced state of the whole matrix, bit ((row * KEYPAD_NUM_COLS) + col) is set if pressed */
+static volatile uint16 g_pressedKeys = 0;
+
+/* The scan task is paused while the keypad rows are used as the wake up source */
+static volatile boolean g_scanEnabled = TRUE;
+
+/*******************************************************************************
+ *                         Flash Tables (Private)                              *
+ *******************************************************************************/
+/* Keypad button value of every switch, indexed by (row * KEYPAD_NUM_COLS) + col */
+static const uint8 KEYPAD_keyMap[KEYPAD_NUM_KEYS] PROGMEM = {
+#if defined(STANDARD_KEYPAD) && (KEYPAD_NUM_COLS == 3)
+	1, 2, 3,
+	4, 5, 6,
+	7, 8, 9,
+	10, 11, 12
+#elif defined(STANDARD_KEYPAD) && (KEYPAD_NUM_COLS == 4)
+	1, 2, 3, 4,
+	5, 6, 7, 8,
+	9, 10, 11, 12,
+	13, 14, 15, 16
+#elif (KEYPAD_NUM_COLS == 3)
+	/* Keypad 4x3 shape in the proteus */
+	1, 2, 3,
+	4, 5, 6,
+	7, 8, 9,
+	'*', 0, '#'
+#elif (KEYPAD_NUM_COLS == 4)
+	/* Keypad 4x4 shape in the proteus, 13 is the ASCII of Enter */
+	7, 8, 9, '%',
+	4, 5, 6, '*',
+	1, 2, 3, '-',
+	13, 0, '=', '+'
 #endif
+};
 
-#endif /* STANDARD_KEYPAD */
+/* Index of the first pressed column in a row columns mask, 0xFF if no column is pressed */
+static const uint8 KEYPAD_firstColumn[1 << KEYPAD_NUM_COLS] PROGMEM = {
+#if (KEYPAD_NUM_COLS == 3)
+	0xFF, 0, 1, 0, 2, 0, 1, 0
+#elif (KEYPAD_NUM_COLS == 4)
+	0xFF, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0
+#endif
+};
 
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
 
-uint8 KEYPAD_getPressedKey(void)
+/*
+ * Description :
+ * Private function to drive one row low and return the columns mask of this row,
+ * bit col is set if the switch in this column is pressed.
+ */
+static inline uint8 KEYPAD_readRow(uint8 row)
+{
+	uint8 cols;
+
+#ifdef KEYPAD_FAST_SCAN
+	/* Only this row is output, all other rows and the columns are inputs (high impedance) */
+	KEYPAD_DDR_REG = (KEYPAD_DDR_REG & (uint8)~(KEYPAD_ROWS_MASK | KEYPAD_COLS_MASK))
+			| (uint8)(1 << (KEYPAD_FIRST_ROW_PIN_ID + row));
+	/* Give the column lines and the input synchronizer time to settle */
+	__asm__ __volatile__ ("nop\n\tnop");
+	/* All the columns in one read, a pressed switch reads low */
+	cols = (uint8)((~KEYPAD_PIN_REG) & KEYPAD_COLS_MASK) >> KEYPAD_FIRST_COL_PIN_ID;
+#else
+	uint8 col;
+
+	cols = 0;
+	GPIO_setupPinDirectionInline(KEYPAD_ROW_PORT_ID,KEYPAD_FIRST_ROW_PIN_ID+row,PIN_OUTPUT);
+	for(col=0 ; col<KEYPAD_NUM_COLS ; col++)
+	{
+		if(GPIO_readPinInline(KEYPAD_COL_PORT_ID,KEYPAD_FIRST_COL_PIN_ID+col) == KEYPAD_BUTTON_PRESSED)
+		{
+			cols |= (1 << col);
+		}
+	}
+	GPIO_setupPinDirectionInline(KEYPAD_ROW_PORT_ID,KEYPAD_FIRST_ROW_PIN_ID+row,PIN_INPUT);
+#endif
+	return cols;
+}
+
+/*
+ * Description :
+ * Private function to write the level of a pressed button on all the rows in one
+ * interrupt safe masked write, the other pins of the rows port keep their values.
+ */
+static inline void KEYPAD_writeRows(void)
+{
+#if (KEYPAD_BUTTON_PRESSED == LOGIC_HIGH)
+	GPIO_writePortMaskedInline(KEYPAD_ROW_PORT_ID,KEYPAD_ROWS_MASK,KEYPAD_ROWS_MASK);
+#else
+	GPIO_writePortMaskedInline(KEYPAD_ROW_PORT_ID,0,KEYPAD_ROWS_MASK);
+#endif
+}
+
+/*
+ * Description :
+ * Private function to prepare the keypad port before a scan, all the rows are low when driven.
+ */
+static inline void KEYPAD_startScan(void)
 {
-	uint8 col,row;
-	GPIO_setupPinDirection(KEYPAD_ROW_PORT_ID, KEYPAD_FIRST_ROW_PIN_ID, PIN_INPUT);
-	GPIO_setupPinDirection(KEYPAD_ROW_PORT_ID, KEYPAD_FIRST_ROW_PIN_ID+1, PIN_INPUT);
-	GPIO_setupPinDirection(KEYPAD_ROW_PORT_ID, KEYPAD_FIRST_ROW_PIN_ID+2, PIN_INPUT);
-	GPIO_setupPinDirection(KEYPAD_ROW_PORT_ID, KEYPAD_FIRST_ROW_PIN_ID+3, PIN_INPUT);
-
-	GPIO_setupPinDirection(KEYPAD_COL_PORT_ID, KEYPAD_FIRST_COL_PIN_ID, PIN_INPUT);
-	GPIO_setupPinDirection(KEYPAD_COL_PORT_ID, KEYPAD_FIRST_COL_PIN_ID+1, PIN_INPUT);
-	GPIO_setupPinDirection(KEYPAD_COL_PORT_ID, KEYPAD_FIRST_COL_PIN_ID+2, PIN_INPUT);
-#if(KEYPAD_NUM_COLS == 4)
-	GPIO_setupPinDirection(KEYPAD_COL_PORT_ID, KEYPAD_FIRST_COL_PIN_ID+3, PIN_INPUT);
+	/* All the rows in one masked write */
+	KEYPAD_writeRows();
+#ifndef KEYPAD_FAST_SCAN
+	/* All the columns are inputs */
+	GPIO_DDR_REG(KEYPAD_COL_PORT_ID) &= (uint8)~KEYPAD_COLS_MASK;
 #endif
+}
+
+/*
+ * Description :
+ * Private function to release the keypad rows after a scan.
+ */
+static inline void KEYPAD_endScan(void)
+{
+#ifdef KEYPAD_FAST_SCAN
+	KEYPAD_DDR_REG &= (uint8)~KEYPAD_ROWS_MASK;
+#endif
+}
+
+/*
+ * Description :
+ * Private function to map a switch to its keypad button value through the flash tables,
+ * the switch is the first pressed column in the row columns mask.
+ */
+static inline uint8 KEYPAD_mapKey(uint8 row, uint8 cols)
+{
+	return pgm_read_byte(&KEYPAD_keyMap[(row * KEYPAD_NUM_COLS) + pgm_read_byte(&KEYPAD_firstColumn[cols])]);
+}
+
+/*
+ * Description :
+ * Scan the keypad matrix one time and return the pressed button,
+ * or KEYPAD_NO_KEY_PRESSED if no button is pressed. The function never blocks.
+ */
+uint8 KEYPAD_checkPressedKey(void)
+{
+	uint8 row,cols;
+
+	KEYPAD_startScan();
+	for(row=0 ; row<KEYPAD_NUM_ROWS ; row++) /* loop for rows */
+	{
+		cols = KEYPAD_readRow(row);
+		if(cols != 0)
+		{
+			KEYPAD_endScan();
+			return KEYPAD_mapKey(row, cols);
+		}
+	}
+	KEYPAD_endScan();
+	return KEYPAD_NO_KEY_PRESSED;
+}
+
+/*
+ * Description :
+ * Wait until a button is pressed and return it
+ */
+uint8 KEYPAD_getPressedKey(void)
+{
+	uint8 key;
 	while(1)
 	{
-		for(row=0 ; row<KEYPAD_NUM_ROWS ; row++) /* loop for rows */
+		key = KEYPAD_checkPressedKey();
+		if(key != KEYPAD_NO_KEY_PRESSED)
 		{
-			/*
-			 * Each time setup the direction for all keypad port as input pins,
-			 * except this row will be output pin
-			 */
-			GPIO_setupPinDirection(KEYPAD_ROW_PORT_ID,KEYPAD_FIRST_ROW_PIN_ID+row,PIN_OUTPUT);
+			return key;
+		}
+		_delay_ms(5); /* Add small delay to fix CPU load issue in proteus */
+	}
+}
 
-			/* Sets the row output pin to low */
-			GPIO_writePin(KEYPAD_ROW_PORT_ID, KEYPAD_FIRST_ROW_PIN_ID+row, KEYPAD_BUTTON_PRESSED);
+/*
+ * Description :
+ * Private function to take a snapshot of the whole keypad matrix,
+ * bit ((row * KEYPAD_NUM_COLS) + col) is set if this switch is pressed.
+ */
+static uint16 KEYPAD_readMatrix(void)
+{
+	uint8 row;
+	uint16 matrix = 0;
+
+	KEYPAD_startScan();
+	for(row=0 ; row<KEYPAD_NUM_ROWS ; row++)
+	{
+		matrix |= (uint16)KEYPAD_readRow(row) << (row * KEYPAD_NUM_COLS);
+	}
+	KEYPAD_endScan();
+	return matrix;
+}
 
-			for(col=0 ; col<KEYPAD_NUM_COLS ; col++) /* loop for columns */
+/*
+ * Description :
+ * Private function to add an event to the typeahead buffer,
+ * the event is dropped and counted if the buffer is full
+ */
+static void KEYPAD_pushEvent(uint8 key, KEYPAD_EventKind kind)
+{
+	uint8 nextHead = (g_eventHead + 1) & (KEYPAD_TYPEAHEAD_SIZE - 1);
+
+	if(nextHead != g_eventTail)
+	{
+		g_eventFifo[g_eventHead].key = key;
+		g_eventFifo[g_eventHead].kind = kind;
+		g_eventHead = nextHead;
+	}
+	else
+	{
+		g_diagnostics.typeahead_overflows++;
+	}
+}
+
+/*
+ * Description :
+ * Private function to detect a possible ghost key in a matrix snapshot.
+ * With the unused rows floating, three pressed keys on three corners of a rectangle
+ * close a path that makes the fourth corner read as pressed.
+ * So a snapshot is ambiguous if two rows share a pressed column and together
+ * have more than one pressed column.
+ */
+static boolean KEYPAD_isGhostPattern(uint16 matrix)
+{
+	uint8 row1,row2;
+	uint8 cols1,cols2,cols;
+
+	for(row1=0 ; row1<(KEYPAD_NUM_ROWS-1) ; row1++)
+	{
+		cols1 = (uint8)(matrix >> (row1 * KEYPAD_NUM_COLS)) & ((1 << KEYPAD_NUM_COLS) - 1);
+		if(cols1 == 0)
+		{
+			continue;
+		}
+		for(row2=row1+1 ; row2<KEYPAD_NUM_ROWS ; row2++)
+		{
+			cols2 = (uint8)(matrix >> (row2 * KEYPAD_NUM_COLS)) & ((1 << KEYPAD_NUM_COLS) - 1);
+			cols = cols1 | cols2;
+			/* Shared column and more than one column in the two rows */
+			if((cols1 & cols2) && (cols & (cols - 1)))
 			{
-				/* Check if the switch is pressed in this column */
-				if(GPIO_readPin(KEYPAD_COL_PORT_ID,KEYPAD_FIRST_COL_PIN_ID+col) == KEYPAD_BUTTON_PRESSED)
-				{
-					#if (KEYPAD_NUM_COLS == 3)
-						#ifdef STANDARD_KEYPAD
-							return ((row*KEYPAD_NUM_COLS)+col+1);
-						#else
-							return KEYPAD_4x3_adjustKeyNumber((row*KEYPAD_NUM_COLS)+col+1);
-						#endif
-					#elif (KEYPAD_NUM_COLS == 4)
-						#ifdef STANDARD_KEYPAD
-							return ((row*KEYPAD_NUM_COLS)+col+1);
-						#else
-							return KEYPAD_4x4_adjustKeyNumber((row*KEYPAD_NUM_COLS)+col+1);
-						#endif
-					#endif
-				}
+				return TRUE;
 			}
-			/* Makes the checked pin to input again to re-check in the next iteration */
-			GPIO_setupPinDirection(KEYPAD_ROW_PORT_ID,KEYPAD_FIRST_ROW_PIN_ID+row,PIN_INPUT);
-			_delay_ms(5); /* Add small delay to fix CPU load issue in proteus */
 		}
 	}
+	return FALSE;
 }
 
-#ifndef STANDARD_KEYPAD
+/*
+ * Description :
+ * Periodic keypad task, it must be called every KEYPAD_SCAN_PERIOD_MS from the system tick:
+ * 1. Take a snapshot of the whole keypad matrix.
+ * 2. Reject the snapshot if it has a ghosting pattern, the keys keep their last state.
+ * 3. Run the debounce state machine of every key, a key changes its state only after
+ *    it keeps the new level for KEYPAD_DEBOUNCE_SCANS consecutive scans.
+ * 4. Add a press or release event to the typeahead buffer when a key changes its state.
+ */
+void KEYPAD_scanTask(void)
+{
+	uint8 index;
+	uint16 matrix;
+	boolean pressed;
+
+	if(!g_scanEnabled)
+	{
+		return;
+	}
+
+	matrix = KEYPAD_readMatrix();
+
+	/* More than one key closed in this snapshot */
+	if(matrix & (matrix - 1))
+	{
+		g_diagnostics.multi_key_scans++;
+		if(KEYPAD_isGhostPattern(matrix))
+		{
+			g_diagnostics.ghost_rejected_scans++;
+			return;
+		}
+	}
+
+	for(index=0 ; index<KEYPAD_NUM_KEYS ; index++)
+	{
+		pressed = (matrix & ((uint16)1 << index)) ? TRUE : FALSE;
+
+		switch(g_keyState[index])
+		{
+		case KEYPAD_KEY_RELEASED:
+			if(pressed)
+			{
+				g_keyState[index] = KEYPAD_KEY_PRESS_DEBOUNCE;
+				g_keyCounter[index] = 1;
+			}
+			break;
+		case KEYPAD_KEY_PRESS_DEBOUNCE:
+			if(!pressed)
+			{
+				g_keyState[index] = KEYPAD_KEY_RELEASED; /* Bounce, ignore it */
+			}
+			else if(++g_keyCounter[index] >= KEYPAD_DEBOUNCE_SCANS)
+			{
+				g_keyState[index] = KEYPAD_KEY_PRESSED;
+				g_pressedKeys |= ((uint16)1 << index);
+				KEYPAD_pushEvent(pgm_read_byte(&KEYPAD_keyMap[index]), KEYPAD_EVENT_PRESSED);
+			}
+			break;
+		case KEYPAD_KEY_PRESSED:
+			if(!pressed)
+			{
+				g_keyState[index] = KEYPAD_KEY_RELEASE_DEBOUNCE;
+				g_keyCounter[index] = 1;
+			}
+			break;
+		case KEYPAD_KEY_RELEASE_DEBOUNCE:
+			if(pressed)
+			{
+				g_keyState[index] = KEYPAD_KEY_PRESSED; /* Bounce, ignore it */
+			}
+			else if(++g_keyCounter[index] >= KEYPAD_DEBOUNCE_SCANS)
+			{
+				g_keyState[index] = KEYPAD_KEY_RELEASED;
+				g_pressedKeys &= ~((uint16)1 << index);
+				KEYPAD_pushEvent(pgm_read_byte(&KEYPAD_keyMap[index]), KEYPAD_EVENT_RELEASED);
+			}
+			break;
+		}
+	}
+}
 
-#if (KEYPAD_NUM_COLS == 3)
 /*
  * Description :
- * Update the keypad pressed button value with the correct one in keypad 4x3 shape
+ * Remove the oldest key event from the typeahead buffer.
+ * Return FALSE if the buffer is empty.
  */
-static uint8 KEYPAD_4x3_adjustKeyNumber(uint8 button_number)
+boolean KEYPAD_getEvent(KEYPAD_EventType *event)
 {
-	uint8 keypad_button = 0;
-	switch(button_number)
+	if(g_eventHead == g_eventTail)
 	{
-		case 10: keypad_button = '*'; // ASCII Code of *
-				 break;
-		case 11: keypad_button = 0;
-				 break;
-		case 12: keypad_button = '#'; // ASCII Code of #
-				 break;
-		default: keypad_button = button_number;
-				break;
+		return FALSE;
 	}
-	return keypad_button;
+	event->key = g_eventFifo[g_eventTail].key;
+	event->kind = g_eventFifo[g_eventTail].kind;
+	g_eventTail = (g_eventTail + 1) & (KEYPAD_TYPEAHEAD_SIZE - 1);
+	return TRUE;
 }
 
-#elif (KEYPAD_NUM_COLS == 4)
+/*
+ * Description :
+ * Return TRUE if there is a key event in the typeahead buffer, it is not removed.
+ */
+boolean KEYPAD_isEventPending(void)
+{
+	return (g_eventHead != g_eventTail);
+}
 
 /*
  * Description :
- * Update the keypad pressed button value with the correct one in keypad 4x4 shape
+ * Remove the key events from the typeahead buffer until a press event is found,
+ * and return its key. Return FALSE if there is no press event in the buffer.
  */
-static uint8 KEYPAD_4x4_adjustKeyNumber(uint8 button_number)
+boolean KEYPAD_getKeyPress(uint8 *key)
 {
-	uint8 keypad_button = 0;
-	switch(button_number)
+	KEYPAD_EventType event;
+
+	while(KEYPAD_getEvent(&event))
 	{
-		case 1: keypad_button = 7;
-				break;
-		case 2: keypad_button = 8;
-				break;
-		case 3: keypad_button = 9;
-				break;
-		case 4: keypad_button = '%'; // ASCII Code of %
-				break;
-		case 5: keypad_button = 4;
-				break;
-		case 6: keypad_button = 5;
-				break;
-		case 7: keypad_button = 6;
-				break;
-		case 8: keypad_button = '*'; /* ASCII Code of '*' */
-				break;
-		case 9: keypad_button = 1;
-				break;
-		case 10: keypad_button = 2;
-				break;
-		case 11: keypad_button = 3;
-				break;
-		case 12: keypad_button = '-'; /* ASCII Code of '-' */
-				break;
-		case 13: keypad_button = 13;  /* ASCII of Enter */
-				break;
-		case 14: keypad_button = 0;
-				break;
-		case 15: keypad_button = '='; /* ASCII Code of '=' */
-				break;
-		case 16: keypad_button = '+'; /* ASCII Code of '+' */
-				break;
-		default: keypad_button = button_number;
-				break;
+		if(event.kind == KEYPAD_EVENT_PRESSED)
+		{
+			*key = event.key;
+			return TRUE;
+		}
 	}
-	return keypad_button;
+	return FALSE;
 }
 
-#endif
+/*
+ * Description :
+ * Return the debounced state of the whole matrix,
+ * bit ((row * KEYPAD_NUM_COLS) + col) is set if this key is pressed.
+ * More than one bit set means a multi-key press.
+ */
+uint16 KEYPAD_getPressedKeys(void)
+{
+	uint16 keys;
+	uint8 sreg = SREG;
+
+	/* 16-bit variable updated by the scan task */
+	cli();
+	keys = g_pressedKeys;
+	SREG = sreg;
+	return keys;
+}
 
-#endif /* STANDARD_KEYPAD */
+/*
+ * Description :
+ * Get the rejected scans and dropped events counters.
+ */
+void KEYPAD_getDiagnostics(KEYPAD_DiagnosticsType *diagnostics)
+{
+	uint8 sreg = SREG;
+
+	cli();
+	diagnostics->ghost_rejected_scans = g_diagnostics.ghost_rejected_scans;
+	diagnostics->multi_key_scans = g_diagnostics.multi_key_scans;
+	diagnostics->typeahead_overflows = g_diagnostics.typeahead_overflows;
+	SREG = sreg;
+}
+
+/*
+ * Description :
+ * Drive all the keypad rows low so any pressed key pulls its column line low,
+ * the column lines are wired-OR into the wake up interrupt pin.
+ */
+void KEYPAD_prepareWakeup(void)
+{
+	/* Stop the scan task before taking the rows */
+	g_scanEnabled = FALSE;
+	KEYPAD_writeRows();
+	GPIO_DDR_REG(KEYPAD_ROW_PORT_ID) |= KEYPAD_ROWS_MASK;
+}
+
+/*
+ * Description :
+ * Return the keypad rows to inputs after the wake up, ready for the normal scan.
+ */
+void KEYPAD_releaseWakeup(void)
+{
+	GPIO_DDR_REG(KEYPAD_ROW_PORT_ID) &= (uint8)~KEYPAD_ROWS_MASK;
+	g_scanEnabled = TRUE;
+}
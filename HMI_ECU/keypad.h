@@ -23,6 +23,7 @@
 /* Keypad configurations for number of rows and columns */
 #define KEYPAD_NUM_COLS                   4
 #define KEYPAD_NUM_ROWS                   4
+#define KEYPAD_NUM_KEYS                   (KEYPAD_NUM_ROWS * KEYPAD_NUM_COLS)
 
 /* Keypad Port Configurations */
 #define KEYPAD_ROW_PORT_ID                PORTA_ID
@@ -35,6 +36,32 @@
 #define KEYPAD_BUTTON_PRESSED            LOGIC_LOW          /*	Pull up resistor */
 #define KEYPAD_BUTTON_RELEASED           LOGIC_HIGH
 
+/* Returned by KEYPAD_checkPressedKey when no button is pressed (0 is a valid key) */
+#define KEYPAD_NO_KEY_PRESSED            0xFF
+
+/* Keypad scan task configurations */
+#define KEYPAD_SCAN_PERIOD_MS            2   /* KEYPAD_scanTask call period */
+#define KEYPAD_DEBOUNCE_SCANS            5   /* Stable scans before a key changes its state (10 ms) */
+#define KEYPAD_TYPEAHEAD_SIZE            16  /* Key events buffer size, it must be a power of 2 */
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+typedef enum {
+	KEYPAD_EVENT_PRESSED, KEYPAD_EVENT_RELEASED
+}KEYPAD_EventKind;
+
+typedef struct {
+	uint8 key;              /* Keypad button value, the same as KEYPAD_getPressedKey */
+	KEYPAD_EventKind kind;
+}KEYPAD_EventType;
+
+typedef struct {
+	uint16 ghost_rejected_scans;  /* Snapshots rejected for a ghosting pattern */
+	uint16 multi_key_scans;       /* Snapshots with more than one closed key */
+	uint8 typeahead_overflows;    /* Events dropped because the typeahead buffer was full */
+}KEYPAD_DiagnosticsType;
+
 
 /*******************************************************************************
  *                      Functions Prototypes                                   *
@@ -42,8 +69,72 @@
 
 /*
  * Description :
- * Get the Keypad pressed button
+ * Get the Keypad pressed button, wait until a button is pressed
+ * Polling API, do not use it while KEYPAD_scanTask is running
  */
 uint8 KEYPAD_getPressedKey(void);
 
+/*
+ * Description :
+ * Scan the keypad one time and return the pressed button,
+ * or KEYPAD_NO_KEY_PRESSED if no button is pressed. The function never blocks.
+ * Polling API, do not use it while KEYPAD_scanTask is running
+ */
+uint8 KEYPAD_checkPressedKey(void);
+
+/*
+ * Description :
+ * Periodic keypad task, it must be called every KEYPAD_SCAN_PERIOD_MS from the system tick.
+ * It rejects the snapshots with a ghosting pattern, debounces every key and adds
+ * a press or release event to the typeahead buffer when a key changes its state.
+ */
+void KEYPAD_scanTask(void);
+
+/*
+ * Description :
+ * Remove the oldest key event from the typeahead buffer.
+ * Return FALSE if the buffer is empty.
+ */
+boolean KEYPAD_getEvent(KEYPAD_EventType *event);
+
+/*
+ * Description :
+ * Return TRUE if there is a key event in the typeahead buffer, it is not removed.
+ */
+boolean KEYPAD_isEventPending(void);
+
+/*
+ * Description :
+ * Remove the key events from the typeahead buffer until a press event is found,
+ * and return its key. Return FALSE if there is no press event in the buffer.
+ */
+boolean KEYPAD_getKeyPress(uint8 *key);
+
+/*
+ * Description :
+ * Return the debounced state of the whole matrix,
+ * bit ((row * KEYPAD_NUM_COLS) + col) is set if this key is pressed.
+ * More than one bit set means a multi-key press.
+ */
+uint16 KEYPAD_getPressedKeys(void);
+
+/*
+ * Description :
+ * Get the rejected scans and dropped events counters.
+ */
+void KEYPAD_getDiagnostics(KEYPAD_DiagnosticsType *diagnostics);
+
+/*
+ * Description :
+ * Drive all the keypad rows low so any pressed key pulls its column line low,
+ * the column lines are wired-OR into the wake up interrupt pin.
+ */
+void KEYPAD_prepareWakeup(void);
+
+/*
+ * Description :
+ * Return the keypad rows to inputs after the wake up, ready for the normal scan.
+ */
+void KEYPAD_releaseWakeup(void);
+
 #endif /* KEYPAD_H_ */
@@ -10,11 +10,231 @@
  *
  *******************************************************************************/
 
+#include <avr/pgmspace.h> /* To read the flash strings */
 #include <util/delay.h> /* For the delay functions */
+#include <util/atomic.h> /* For ATOMIC_BLOCK */
 #include "common_macros.h" /* For GET_BIT Macro */
 #include "lcd.h"
 #include "gpio.h"
 
+/*******************************************************************************
+ *                         Preprocessor Macros (Private)                       *
+ *******************************************************************************/
+/*
+ * Fast nibble write: in 4-bits mode, if DB4 --> DB7 are consecutive pins of the data port,
+ * every nibble is one masked write to the port register instead of one pin write per data pin.
+ * Scattered wiring falls back to the pin writes.
+ */
+#if (LCD_DATA_BITS_MODE == 4) && (LCD_DB5_PIN_ID == (LCD_DB4_PIN_ID + 1)) \
+	&& (LCD_DB6_PIN_ID == (LCD_DB4_PIN_ID + 2)) && (LCD_DB7_PIN_ID == (LCD_DB4_PIN_ID + 3))
+#define LCD_FAST_NIBBLE
+#define LCD_DATA_NIBBLE_MASK ((uint8)(0x0F << LCD_DB4_PIN_ID))
+#endif
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+/* Screen content written by the application, read by the refresh task every system tick */
+static volatile uint8 g_frameBuffer[LCD_ROWS][LCD_COLS];
+/* Copy of what is on the glass, owned by the refresh task */
+static uint8 g_glassBuffer[LCD_ROWS][LCD_COLS];
+/* Set by every frame buffer write, so an unchanged frame is not compared again */
+static volatile boolean g_frameChanged = FALSE;
+/* Refresh task position, the pass is finished when the row reaches LCD_ROWS */
+static uint8 g_refreshRow = LCD_ROWS;
+static uint8 g_refreshCol = 0;
+/* The LCD address counter points at the refresh position */
+static boolean g_refreshCursorInPlace = FALSE;
+/* Glyph loaded in every CGRAM slot, LCD_GLYPH_NONE if the slot is not defined */
+static volatile uint8 g_cgramGlyph[LCD_CGRAM_SLOTS];
+/* Slots waiting for an upload to the CGRAM, one bit per slot */
+static volatile uint8 g_cgramPending = 0;
+/* Slot uploaded by the refresh task and its next row, LCD_CGRAM_SLOTS if no upload is running */
+static uint8 g_uploadSlot = LCD_CGRAM_SLOTS;
+static uint8 g_uploadRow = 0;
+
+/* Custom characters dots, one byte per row from the top, the lower 5 bits are the columns */
+static const uint8 LCD_glyphTable[LCD_NUM_GLYPHS][LCD_GLYPH_ROWS] PROGMEM = {
+	{ 0x0E, 0x11, 0x11, 0x1F, 0x1B, 0x1B, 0x1F, 0x00 }, /* LCD_GLYPH_LOCK */
+	{ 0x0E, 0x10, 0x10, 0x1F, 0x1B, 0x1B, 0x1F, 0x00 }, /* LCD_GLYPH_UNLOCK */
+	{ 0x00, 0x01, 0x01, 0x05, 0x05, 0x15, 0x15, 0x00 }, /* LCD_GLYPH_LINK */
+	{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10 }, /* LCD_GLYPH_PROGRESS_1 */
+	{ 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18 }, /* LCD_GLYPH_PROGRESS_2 */
+	{ 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C, 0x1C }, /* LCD_GLYPH_PROGRESS_3 */
+	{ 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E, 0x1E }  /* LCD_GLYPH_PROGRESS_4 */
+};
+/* Frame buffer cursor position */
+static uint8 g_frameRow = 0;
+static uint8 g_frameCol = 0;
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*******************************************************************************
+ *                      Functions Definitions (Private)                        *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Private function to latch the data bus into the LCD with one Enable pulse.
+ * The pin writes before the pulse take at least 2 cycles (250ns), they already cover the
+ * address setup time Tas = 40ns and the data setup time Tdsw = 80ns, so only the pulse width needs a delay.
+ */
+static void LCD_strobe(void)
+{
+	GPIO_writePinInline(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_HIGH); /* Enable LCD E=1 */
+	_delay_us(1); /* delay for processing Tpw = 230ns */
+	GPIO_writePinInline(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
+	_delay_us(1); /* delay for processing Th = 10ns and the Enable cycle time Tcyce = 500ns */
+}
+
+#if(LCD_DATA_BITS_MODE == 4)
+/*
+ * Description :
+ * Private function to send the lower 4 bits of the value on DB4 --> DB7
+ */
+static void LCD_writeNibble(uint8 nibble)
+{
+#ifdef LCD_FAST_NIBBLE
+	/* DB4 --> DB7 in one write, the other pins of the data port keep their values */
+	GPIO_writePortMaskedInline(LCD_DATA_PORT_ID,(uint8)((nibble & 0x0F) << LCD_DB4_PIN_ID),LCD_DATA_NIBBLE_MASK);
+#else
+	GPIO_writePinInline(LCD_DATA_PORT_ID,LCD_DB4_PIN_ID,GET_BIT(nibble,0));
+	GPIO_writePinInline(LCD_DATA_PORT_ID,LCD_DB5_PIN_ID,GET_BIT(nibble,1));
+	GPIO_writePinInline(LCD_DATA_PORT_ID,LCD_DB6_PIN_ID,GET_BIT(nibble,2));
+	GPIO_writePinInline(LCD_DATA_PORT_ID,LCD_DB7_PIN_ID,GET_BIT(nibble,3));
+#endif
+	LCD_strobe();
+}
+#endif
+
+/*
+ * Description :
+ * Private function to setup the direction of the LCD data pins,
+ * all the data port in 8-bits mode or DB4 --> DB7 only in 4-bits mode
+ */
+static void LCD_setupDataDirection(GPIO_PinDirectionType direction)
+{
+#if(LCD_DATA_BITS_MODE == 4)
+#ifdef LCD_FAST_NIBBLE
+	if(direction == PIN_OUTPUT)
+	{
+		GPIO_DDR_REG(LCD_DATA_PORT_ID) |= LCD_DATA_NIBBLE_MASK;
+	}
+	else
+	{
+		GPIO_DDR_REG(LCD_DATA_PORT_ID) &= (uint8)~LCD_DATA_NIBBLE_MASK;
+	}
+#else
+	GPIO_setupPinDirectionInline(LCD_DATA_PORT_ID,LCD_DB4_PIN_ID,direction);
+	GPIO_setupPinDirectionInline(LCD_DATA_PORT_ID,LCD_DB5_PIN_ID,direction);
+	GPIO_setupPinDirectionInline(LCD_DATA_PORT_ID,LCD_DB6_PIN_ID,direction);
+	GPIO_setupPinDirectionInline(LCD_DATA_PORT_ID,LCD_DB7_PIN_ID,direction);
+#endif
+#elif(LCD_DATA_BITS_MODE == 8)
+	GPIO_setupPortDirectionInline(LCD_DATA_PORT_ID,(direction == PIN_OUTPUT) ? PORT_OUTPUT : PORT_INPUT);
+#endif
+}
+
+#if (LCD_READ_BUSY_FLAG == TRUE)
+/*
+ * Description :
+ * Private function to wait until the LCD finishes the last instruction:
+ * 1. Turn the data pins to inputs and select the read instruction register mode RS=0 R/W=1.
+ * 2. Read the busy flag on DB7 while E=1 until it is cleared, in 4-bits mode the lower nibble
+ *    is clocked out and ignored.
+ * 3. Give up after LCD_BUSY_FLAG_TIMEOUT reads, so a missing LCD can not hang the system.
+ * 4. Return the data pins to outputs and R/W=0.
+ */
+static void LCD_waitBusyFlag(void)
+{
+	uint16 reads = 0;
+	uint8 busy;
+
+	LCD_setupDataDirection(PIN_INPUT);
+
+#if (LCD_RS_PORT_ID == LCD_RW_PORT_ID)
+	/* Instruction Mode RS=0 and Read Mode R/W=1 in one write */
+	GPIO_writePortMaskedInline(LCD_RS_PORT_ID,(1<<LCD_RW_PIN_ID),(1<<LCD_RS_PIN_ID));
+#else
+	GPIO_writePinInline(LCD_RS_PORT_ID,LCD_RS_PIN_ID,LOGIC_LOW); /* Instruction Mode RS=0 */
+	GPIO_writePinInline(LCD_RW_PORT_ID,LCD_RW_PIN_ID,LOGIC_HIGH); /* Read Mode R/W=1 */
+#endif
+
+	do
+	{
+		GPIO_writePinInline(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_HIGH); /* Enable LCD E=1 */
+		_delay_us(1); /* delay for processing Tddr = 160ns */
+#if(LCD_DATA_BITS_MODE == 4)
+		busy = GPIO_readPinInline(LCD_DATA_PORT_ID,LCD_DB7_PIN_ID);
+		GPIO_writePinInline(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
+		_delay_us(1); /* delay for processing the Enable cycle time Tcyce = 500ns */
+		LCD_strobe(); /* Clock out the lower nibble of the address counter */
+#elif(LCD_DATA_BITS_MODE == 8)
+		busy = GPIO_readPinInline(LCD_DATA_PORT_ID,PIN7_ID);
+		GPIO_writePinInline(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
+		_delay_us(1); /* delay for processing the Enable cycle time Tcyce = 500ns */
+#endif
+		reads++;
+	}while((busy == LOGIC_HIGH) && (reads < LCD_BUSY_FLAG_TIMEOUT));
+
+	GPIO_writePinInline(LCD_RW_PORT_ID,LCD_RW_PIN_ID,LOGIC_LOW); /* Write Mode R/W=0 */
+
+	LCD_setupDataDirection(PIN_OUTPUT);
+}
+#endif
+
+/*
+ * Description :
+ * Private function to send one byte to the instruction register (RS=0) or the data register (RS=1).
+ * With the busy flag the LCD is polled before the write, so the CPU is free while the LCD executes.
+ * Without it the caller must leave the execution time before the next write.
+ * The busy flag is not valid before the function set command, LCD_init sends it without polling.
+ */
+static void LCD_writeByte(uint8 rs,uint8 value)
+{
+#if (LCD_READ_BUSY_FLAG == TRUE)
+	LCD_waitBusyFlag();
+#endif
+
+	GPIO_writePinInline(LCD_RS_PORT_ID,LCD_RS_PIN_ID,rs);
+
+#if(LCD_DATA_BITS_MODE == 4)
+	LCD_writeNibble(value >> 4);
+	LCD_writeNibble(value);
+#elif(LCD_DATA_BITS_MODE == 8)
+	GPIO_writePortInline(LCD_DATA_PORT_ID,value); /* out the required value to the data bus D0 --> D7 */
+	LCD_strobe();
+#endif
+}
+
+/*
+ * Description :
+ * Private function to calculate the LCD DDRAM address of a specified row and column index
+ */
+static uint8 LCD_getAddress(uint8 row,uint8 col)
+{
+	uint8 lcd_memory_address = col;
+
+	switch(row)
+	{
+		case 0:
+			lcd_memory_address=col;
+				break;
+		case 1:
+			lcd_memory_address=col+0x40;
+				break;
+		case 2:
+			lcd_memory_address=col+0x10;
+				break;
+		case 3:
+			lcd_memory_address=col+0x50;
+				break;
+	}
+	return lcd_memory_address;
+}
+
 /*******************************************************************************
  *                      Functions Definitions                                  *
  *******************************************************************************/
@@ -27,37 +247,79 @@
  */
 void LCD_init(void)
 {
+	uint8 row,col;
+
 	/* Configure the direction for RS and E pins as output pins */
-	GPIO_setupPinDirection(LCD_RS_PORT_ID,LCD_RS_PIN_ID,PIN_OUTPUT);
-	GPIO_setupPinDirection(LCD_E_PORT_ID,LCD_E_PIN_ID,PIN_OUTPUT);
+	GPIO_setupPinDirectionInline(LCD_RS_PORT_ID,LCD_RS_PIN_ID,PIN_OUTPUT);
+	GPIO_setupPinDirectionInline(LCD_E_PORT_ID,LCD_E_PIN_ID,PIN_OUTPUT);
+	GPIO_writePinInline(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW);
+
+#if (LCD_READ_BUSY_FLAG == TRUE)
+	/* Configure the R/W pin as output pin in write mode */
+	GPIO_setupPinDirectionInline(LCD_RW_PORT_ID,LCD_RW_PIN_ID,PIN_OUTPUT);
+	GPIO_writePinInline(LCD_RW_PORT_ID,LCD_RW_PIN_ID,LOGIC_LOW);
+#endif
+
+	/* Configure the backlight pin as output pin and turn on the backlight */
+	GPIO_setupPinDirectionInline(LCD_BACKLIGHT_PORT_ID,LCD_BACKLIGHT_PIN_ID,PIN_OUTPUT);
+	LCD_backlightOn();
 
 	_delay_ms(20);		/* LCD Power ON delay always > 15ms */
 
+	GPIO_writePinInline(LCD_RS_PORT_ID,LCD_RS_PIN_ID,LOGIC_LOW); /* Instruction Mode RS=0 */
+
 #if(LCD_DATA_BITS_MODE == 4)
 	/* Configure 4 pins in the data port as output pins */
-	GPIO_setupPinDirection(LCD_DATA_PORT_ID,LCD_DB4_PIN_ID,PIN_OUTPUT);
-	GPIO_setupPinDirection(LCD_DATA_PORT_ID,LCD_DB5_PIN_ID,PIN_OUTPUT);
-	GPIO_setupPinDirection(LCD_DATA_PORT_ID,LCD_DB6_PIN_ID,PIN_OUTPUT);
-	GPIO_setupPinDirection(LCD_DATA_PORT_ID,LCD_DB7_PIN_ID,PIN_OUTPUT);
+	LCD_setupDataDirection(PIN_OUTPUT);
 
-	/* Send for 4 bit initialization of LCD  */
-	LCD_sendCommand(LCD_TWO_LINES_FOUR_BITS_MODE_INIT1);
-	LCD_sendCommand(LCD_TWO_LINES_FOUR_BITS_MODE_INIT2);
+	/*
+	 * Initialization by instruction for 4 bit mode, the LCD may be in 8-bits or 4-bits mode
+	 * so the upper nibble of the 8-bits function set is sent alone three times, then 4-bits mode.
+	 * The busy flag can not be checked during this sequence.
+	 */
+	LCD_writeNibble(LCD_TWO_LINES_FOUR_BITS_MODE_INIT1 >> 4);
+	_delay_ms(5); /* wait more than 4.1ms */
+	LCD_writeNibble(LCD_TWO_LINES_FOUR_BITS_MODE_INIT1 >> 4);
+	_delay_us(150); /* wait more than 100us */
+	LCD_writeNibble(LCD_TWO_LINES_FOUR_BITS_MODE_INIT1 >> 4);
+	_delay_us(LCD_EXECUTION_TIME_US);
+	LCD_writeNibble(LCD_TWO_LINES_FOUR_BITS_MODE_INIT2 & 0x0F);
+	_delay_us(LCD_EXECUTION_TIME_US);
 
 	/* use 2-lines LCD + 4-bits Data Mode + 5*7 dot display Mode */
-	LCD_sendCommand(LCD_TWO_LINES_FOUR_BITS_MODE);
+	LCD_writeNibble(LCD_TWO_LINES_FOUR_BITS_MODE >> 4);
+	LCD_writeNibble(LCD_TWO_LINES_FOUR_BITS_MODE);
+	_delay_us(LCD_EXECUTION_TIME_US);
 
 #elif(LCD_DATA_BITS_MODE == 8)
 	/* Configure the data port as output port */
-	GPIO_setupPortDirection(LCD_DATA_PORT_ID,PORT_OUTPUT);
+	LCD_setupDataDirection(PIN_OUTPUT);
 
-	/* use 2-lines LCD + 8-bits Data Mode + 5*7 dot display Mode */
-	LCD_sendCommand(LCD_TWO_LINES_EIGHT_BITS_MODE);
+	/* use 2-lines LCD + 8-bits Data Mode + 5*7 dot display Mode, the busy flag is not valid yet */
+	GPIO_writePortInline(LCD_DATA_PORT_ID,LCD_TWO_LINES_EIGHT_BITS_MODE);
+	LCD_strobe();
+	_delay_us(LCD_EXECUTION_TIME_US);
 
 #endif
 
 	LCD_sendCommand(LCD_CURSOR_OFF); /* cursor off */
 	LCD_sendCommand(LCD_CLEAR_COMMAND); /* clear LCD at the beginning */
+
+	/* The CGRAM content is unknown after reset */
+	for(row=0 ; row<LCD_CGRAM_SLOTS ; row++)
+	{
+		g_cgramGlyph[row] = LCD_GLYPH_NONE;
+	}
+
+	/* The glass is clear, start the frame buffer and its glass copy with spaces */
+	LCD_FB_clearScreen();
+	for(row=0 ; row<LCD_ROWS ; row++)
+	{
+		for(col=0 ; col<LCD_COLS ; col++)
+		{
+			g_glassBuffer[row][col] = ' ';
+		}
+	}
 }
 
 /*
@@ -66,37 +328,18 @@ void LCD_init(void)
  */
 void LCD_sendCommand(uint8 command)
 {
-	GPIO_writePin(LCD_RS_PORT_ID,LCD_RS_PIN_ID,LOGIC_LOW); /* Instruction Mode RS=0 */
-	_delay_ms(1); /* delay for processing Tas = 50ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_HIGH); /* Enable LCD E=1 */
-	_delay_ms(1); /* delay for processing Tpw - Tdws = 190ns */
+	LCD_writeByte(LOGIC_LOW,command); /* Instruction Mode RS=0 */
 
-#if(LCD_DATA_BITS_MODE == 4)
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB4_PIN_ID,GET_BIT(command,4));
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB5_PIN_ID,GET_BIT(command,5));
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB6_PIN_ID,GET_BIT(command,6));
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB7_PIN_ID,GET_BIT(command,7));
-
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_HIGH); /* Enable LCD E=1 */
-	_delay_ms(1); /* delay for processing Tpw - Tdws = 190ns */
-
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB4_PIN_ID,GET_BIT(command,0));
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB5_PIN_ID,GET_BIT(command,1));
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB6_PIN_ID,GET_BIT(command,2));
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB7_PIN_ID,GET_BIT(command,3));
-
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
-
-#elif(LCD_DATA_BITS_MODE == 8)
-	GPIO_writePort(LCD_DATA_PORT_ID,command); /* out the required command to the data bus D0 --> D7 */
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
+#if (LCD_READ_BUSY_FLAG == FALSE)
+	/* Clear and home need a longer execution time than the other commands */
+	if((command == LCD_CLEAR_COMMAND) || (command == LCD_GO_TO_HOME))
+	{
+		_delay_us(LCD_CLEAR_EXECUTION_TIME_US);
+	}
+	else
+	{
+		_delay_us(LCD_EXECUTION_TIME_US);
+	}
 #endif
 }
 
@@ -106,37 +349,10 @@ void LCD_sendCommand(uint8 command)
  */
 void LCD_displayCharacter(uint8 data)
 {
-	GPIO_writePin(LCD_RS_PORT_ID,LCD_RS_PIN_ID,LOGIC_HIGH); /* Data Mode RS=1 */
-	_delay_ms(1); /* delay for processing Tas = 50ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_HIGH); /* Enable LCD E=1 */
-	_delay_ms(1); /* delay for processing Tpw - Tdws = 190ns */
+	LCD_writeByte(LOGIC_HIGH,data); /* Data Mode RS=1 */
 
-#if(LCD_DATA_BITS_MODE == 4)
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB4_PIN_ID,GET_BIT(data,4));
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB5_PIN_ID,GET_BIT(data,5));
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB6_PIN_ID,GET_BIT(data,6));
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB7_PIN_ID,GET_BIT(data,7));
-
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_HIGH); /* Enable LCD E=1 */
-	_delay_ms(1); /* delay for processing Tpw - Tdws = 190ns */
-
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB4_PIN_ID,GET_BIT(data,0));
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB5_PIN_ID,GET_BIT(data,1));
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB6_PIN_ID,GET_BIT(data,2));
-	GPIO_writePin(LCD_DATA_PORT_ID,LCD_DB7_PIN_ID,GET_BIT(data,3));
-
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
-
-#elif(LCD_DATA_BITS_MODE == 8)
-	GPIO_writePort(LCD_DATA_PORT_ID,data); /* out the required command to the data bus D0 --> D7 */
-	_delay_ms(1); /* delay for processing Tdsw = 100ns */
-	GPIO_writePin(LCD_E_PORT_ID,LCD_E_PIN_ID,LOGIC_LOW); /* Disable LCD E=0 */
-	_delay_ms(1); /* delay for processing Th = 13ns */
+#if (LCD_READ_BUSY_FLAG == FALSE)
+	_delay_us(LCD_EXECUTION_TIME_US);
 #endif
 }
 
@@ -161,32 +377,28 @@ void LCD_displayString(const char *Str)
 	*********************************************************/
 }
 
+/*
+ * Description :
+ * Display the required string stored in flash (PROGMEM) on the screen
+ */
+void LCD_displayString_P(const char *Str)
+{
+	uint8 data;
+	while((data = pgm_read_byte(Str)) != '\0')
+	{
+		LCD_displayCharacter(data);
+		Str++;
+	}
+}
+
 /*
  * Description :
  * Move the cursor to a specified row and column index on the screen
  */
 void LCD_moveCursor(uint8 row,uint8 col)
 {
-	uint8 lcd_memory_address;
-	
-	/* Calculate the required address in the LCD DDRAM */
-	switch(row)
-	{
-		case 0:
-			lcd_memory_address=col;
-				break;
-		case 1:
-			lcd_memory_address=col+0x40;
-				break;
-		case 2:
-			lcd_memory_address=col+0x10;
-				break;
-		case 3:
-			lcd_memory_address=col+0x50;
-				break;
-	}					
-	/* Move the LCD cursor to this specific address */
-	LCD_sendCommand(lcd_memory_address | LCD_SET_CURSOR_LOCATION);
+	/* Move the LCD cursor to the required address in the LCD DDRAM */
+	LCD_sendCommand(LCD_getAddress(row,col) | LCD_SET_CURSOR_LOCATION);
 }
 
 /*
@@ -199,6 +411,16 @@ void LCD_displayStringRowColumn(uint8 row,uint8 col,const char *Str)
 	LCD_displayString(Str); /* display the string */
 }
 
+/*
+ * Description :
+ * Display the required string stored in flash (PROGMEM) in a specified row and column index on the screen
+ */
+void LCD_displayStringRowColumn_P(uint8 row,uint8 col,const char *Str)
+{
+	LCD_moveCursor(row,col); /* go to to the required LCD position */
+	LCD_displayString_P(Str); /* display the string */
+}
+
 /*
  * Description :
  * Display the required decimal value on the screen
@@ -218,3 +440,300 @@ void LCD_clearScreen(void)
 {
 	LCD_sendCommand(LCD_CLEAR_COMMAND); /* Send clear display command */
 }
+
+/*
+ * Description :
+ * Turn on the LCD backlight
+ */
+void LCD_backlightOn(void)
+{
+	GPIO_writePinInline(LCD_BACKLIGHT_PORT_ID,LCD_BACKLIGHT_PIN_ID,LOGIC_HIGH);
+}
+
+/*
+ * Description :
+ * Turn off the LCD backlight
+ */
+void LCD_backlightOff(void)
+{
+	GPIO_writePinInline(LCD_BACKLIGHT_PORT_ID,LCD_BACKLIGHT_PIN_ID,LOGIC_LOW);
+}
+
+/*
+ * Description :
+ * Fill the frame buffer with spaces and move its cursor to the first row and column
+ */
+void LCD_FB_clearScreen(void)
+{
+	uint8 row,col;
+	for(row=0 ; row<LCD_ROWS ; row++)
+	{
+		for(col=0 ; col<LCD_COLS ; col++)
+		{
+			g_frameBuffer[row][col] = ' ';
+		}
+	}
+	g_frameRow = 0;
+	g_frameCol = 0;
+	g_frameChanged = TRUE;
+}
+
+/*
+ * Description :
+ * Move the frame buffer cursor to a specified row and column index
+ */
+void LCD_FB_moveCursor(uint8 row,uint8 col)
+{
+	g_frameRow = row;
+	g_frameCol = col;
+}
+
+/*
+ * Description :
+ * Write the required character in the frame buffer at the cursor position,
+ * characters after the end of the row are ignored
+ */
+void LCD_FB_displayCharacter(uint8 data)
+{
+	if((g_frameRow < LCD_ROWS) && (g_frameCol < LCD_COLS))
+	{
+		/* Rewriting the same character does not start a refresh pass */
+		if(g_frameBuffer[g_frameRow][g_frameCol] != data)
+		{
+			g_frameBuffer[g_frameRow][g_frameCol] = data;
+			g_frameChanged = TRUE;
+		}
+		g_frameCol++;
+	}
+}
+
+/*
+ * Description :
+ * Write the required string in the frame buffer at the cursor position
+ */
+void LCD_FB_displayString(const char *Str)
+{
+	uint8 i = 0;
+	while(Str[i] != '\0')
+	{
+		LCD_FB_displayCharacter(Str[i]);
+		i++;
+	}
+}
+
+/*
+ * Description :
+ * Write the required string stored in flash (PROGMEM) in the frame buffer at the cursor position
+ */
+void LCD_FB_displayString_P(const char *Str)
+{
+	uint8 data;
+	while((data = pgm_read_byte(Str)) != '\0')
+	{
+		LCD_FB_displayCharacter(data);
+		Str++;
+	}
+}
+
+/*
+ * Description :
+ * Write the required string in the frame buffer at a specified row and column index
+ */
+void LCD_FB_displayStringRowColumn(uint8 row,uint8 col,const char *Str)
+{
+	LCD_FB_moveCursor(row,col);
+	LCD_FB_displayString(Str);
+}
+
+/*
+ * Description :
+ * Write the required string stored in flash (PROGMEM) in the frame buffer at a specified row and column index
+ */
+void LCD_FB_displayStringRowColumn_P(uint8 row,uint8 col,const char *Str)
+{
+	LCD_FB_moveCursor(row,col);
+	LCD_FB_displayString_P(Str);
+}
+
+/*
+ * Description :
+ * Send the next frame buffer changes to the screen, at most LCD_REFRESH_BYTES_PER_TICK bytes:
+ * 0. Upload the pending CGRAM slots first, the set CGRAM address command then 8 rows,
+ *    the LCD address counter is in the CGRAM after that so the cursor must be moved again.
+ * 1. Start a new pass over the frame buffer if it was written since the last pass started,
+ *    a cell written during a pass is sent by this pass or the next one.
+ * 2. Skip the cells that match the glass copy.
+ * 3. Move the LCD cursor only at the start of a changed run, the LCD address counter
+ *    increments by itself after every character. Every cursor move or character is one byte.
+ * Return TRUE if there are still changes to send.
+ * It is called every system tick from the main context, when the busy flag is not read
+ * it waits the LCD execution time after its byte as two ticks may run less than 1 msec apart.
+ */
+boolean LCD_FB_refreshTask(void)
+{
+	uint8 bytes = 0;
+	boolean pending = TRUE;
+	uint8 data;
+
+	while(bytes < LCD_REFRESH_BYTES_PER_TICK)
+	{
+		if((g_uploadSlot >= LCD_CGRAM_SLOTS) && (g_cgramPending != 0))
+		{
+			/* Start the upload of the first pending slot */
+			g_uploadSlot = 0;
+			while(BIT_IS_CLEAR(g_cgramPending,g_uploadSlot))
+			{
+				g_uploadSlot++;
+			}
+			CLEAR_BIT(g_cgramPending,g_uploadSlot);
+			g_uploadRow = 0;
+			LCD_writeByte(LOGIC_LOW,LCD_SET_CGRAM_ADDRESS | (g_uploadSlot << 3));
+			g_refreshCursorInPlace = FALSE;
+			bytes++;
+			continue;
+		}
+		if(g_uploadSlot < LCD_CGRAM_SLOTS)
+		{
+			LCD_writeByte(LOGIC_HIGH,pgm_read_byte(&LCD_glyphTable[g_cgramGlyph[g_uploadSlot]][g_uploadRow]));
+			g_uploadRow++;
+			if(g_uploadRow >= LCD_GLYPH_ROWS)
+			{
+				g_uploadSlot = LCD_CGRAM_SLOTS;
+			}
+			bytes++;
+			continue;
+		}
+
+		if(g_refreshRow >= LCD_ROWS)
+		{
+			if(!g_frameChanged)
+			{
+				pending = FALSE;
+				break;
+			}
+			/* Start a new pass */
+			g_frameChanged = FALSE;
+			g_refreshRow = 0;
+			g_refreshCol = 0;
+			g_refreshCursorInPlace = FALSE;
+		}
+
+		data = g_frameBuffer[g_refreshRow][g_refreshCol];
+		if(data != g_glassBuffer[g_refreshRow][g_refreshCol])
+		{
+			if(!g_refreshCursorInPlace)
+			{
+				LCD_writeByte(LOGIC_LOW,LCD_getAddress(g_refreshRow,g_refreshCol) | LCD_SET_CURSOR_LOCATION);
+				g_refreshCursorInPlace = TRUE;
+				bytes++;
+				continue;
+			}
+			LCD_writeByte(LOGIC_HIGH,data);
+			g_glassBuffer[g_refreshRow][g_refreshCol] = data;
+			bytes++;
+		}
+		else
+		{
+			g_refreshCursorInPlace = FALSE;
+		}
+
+		g_refreshCol++;
+		if(g_refreshCol >= LCD_COLS)
+		{
+			/* The LCD address counter does not continue to the next row */
+			g_refreshCol = 0;
+			g_refreshRow++;
+			g_refreshCursorInPlace = FALSE;
+		}
+	}
+#if (LCD_READ_BUSY_FLAG == FALSE)
+	if(bytes != 0)
+	{
+		_delay_us(LCD_EXECUTION_TIME_US);
+	}
+#endif
+	return pending;
+}
+
+/*
+ * Description :
+ * Load the required glyph in a CGRAM slot and return the character code that shows it.
+ * The slot is uploaded by the refresh task only if it holds another glyph,
+ * the frame buffer cells that show the slot change on the glass without any DDRAM write.
+ */
+uint8 LCD_FB_setGlyph(uint8 slot,LCD_GlyphType glyph)
+{
+	if((slot < LCD_CGRAM_SLOTS) && (glyph < LCD_NUM_GLYPHS) && (g_cgramGlyph[slot] != glyph))
+	{
+		/* The refresh task clears the pending bits */
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			g_cgramGlyph[slot] = glyph;
+			SET_BIT(g_cgramPending,slot);
+		}
+	}
+	return LCD_GLYPH_CODE(slot);
+}
+
+/*
+ * Description :
+ * Draw a progress bar of width cells in the frame buffer at a specified row and column index,
+ * filled with value/max of its columns:
+ * 1. Every cell has LCD_GLYPH_WIDTH columns, full cells use the ROM full block.
+ * 2. The last partly filled cell uses the progress segment glyph of its filled columns.
+ * 3. The remaining cells are spaces.
+ */
+void LCD_FB_displayProgressBar(uint8 row,uint8 col,uint8 width,uint16 value,uint16 max)
+{
+	uint16 columns = 0;
+	uint8 i;
+
+	for(i=0 ; i<LCD_PROGRESS_SEGMENTS ; i++)
+	{
+		LCD_FB_setGlyph(LCD_PROGRESS_FIRST_SLOT + i,LCD_GLYPH_PROGRESS_1 + i);
+	}
+
+	if(value > max)
+	{
+		value = max;
+	}
+	if(max != 0)
+	{
+		columns = (uint16)(((uint32)value * width * LCD_GLYPH_WIDTH) / max);
+	}
+
+	LCD_FB_moveCursor(row,col);
+	for(i=0 ; i<width ; i++)
+	{
+		if(columns >= LCD_GLYPH_WIDTH)
+		{
+			LCD_FB_displayCharacter(LCD_FULL_BLOCK);
+			columns -= LCD_GLYPH_WIDTH;
+		}
+		else if(columns > 0)
+		{
+			LCD_FB_displayCharacter(LCD_GLYPH_CODE(LCD_PROGRESS_FIRST_SLOT + columns - 1));
+			columns = 0;
+		}
+		else
+		{
+			LCD_FB_displayCharacter(' ');
+		}
+	}
+}
+
+/*
+ * Description :
+ * Send all the frame buffer changes to the screen and return when the glass is up to date.
+ * It runs the refresh task steps back to back, so it can be used before the system tick
+ * is started, each step waits the LCD execution time itself.
+ */
+void LCD_FB_flush(void)
+{
+	boolean pending;
+
+	do
+	{
+		pending = LCD_FB_refreshTask();
+	}while(pending);
+}
@@ -28,6 +28,10 @@
 
 #endif
 
+/* LCD size, used by the shadow frame buffer */
+#define LCD_ROWS                       2
+#define LCD_COLS                       16
+
 /* LCD HW Ports and Pins Ids */
 #define LCD_RS_PORT_ID                 PORTB_ID
 #define LCD_RS_PIN_ID                  PIN0_ID
@@ -37,6 +41,43 @@
 
 #define LCD_DATA_PORT_ID               PORTC_ID
 
+#define LCD_BACKLIGHT_PORT_ID          PORTD_ID
+#define LCD_BACKLIGHT_PIN_ID           PIN6_ID
+
+/*
+ * LCD busy flag configuration, set it to TRUE if the LCD R/W pin is connected to LCD_RW_PIN_ID,
+ * or FALSE if R/W is tied to ground and the driver waits the datasheet execution times
+ */
+#define LCD_READ_BUSY_FLAG             FALSE
+
+#if (LCD_READ_BUSY_FLAG == TRUE)
+
+#define LCD_RW_PORT_ID                 PORTB_ID
+#define LCD_RW_PIN_ID                  PIN3_ID
+
+/* Maximum busy flag reads before giving up, about 4usec each covers the 1.52msec clear command */
+#define LCD_BUSY_FLAG_TIMEOUT          1000
+
+#endif
+
+/*
+ * HD44780 execution times with fosc = 270KHz, used when the busy flag is not read
+ * and during the initialization before the busy flag is valid
+ */
+#define LCD_EXECUTION_TIME_US          40
+#define LCD_CLEAR_EXECUTION_TIME_US    1600
+
+/*
+ * Maximum bytes sent to the LCD by one LCD_FB_refreshTask call.
+ * Without the busy flag one byte per 1msec tick followed by the execution time wait.
+ * With the busy flag every byte waits about 40usec on the busy flag, 4 bytes keep the tick short.
+ */
+#if (LCD_READ_BUSY_FLAG == TRUE)
+#define LCD_REFRESH_BYTES_PER_TICK     4
+#else
+#define LCD_REFRESH_BYTES_PER_TICK     1
+#endif
+
 #if (LCD_DATA_BITS_MODE == 4)
 
 #define LCD_DB4_PIN_ID                 PIN3_ID
@@ -56,6 +97,34 @@
 #define LCD_CURSOR_OFF                       0x0C
 #define LCD_CURSOR_ON                        0x0E
 #define LCD_SET_CURSOR_LOCATION              0x80
+#define LCD_SET_CGRAM_ADDRESS                0x40
+
+/* Custom characters (CGRAM), 8 slots of 5x8 dots */
+#define LCD_CGRAM_SLOTS                8
+#define LCD_GLYPH_ROWS                 8
+#define LCD_GLYPH_WIDTH                5
+#define LCD_GLYPH_NONE                 0xFF
+/*
+ * Character code of a CGRAM slot, codes 0x08 --> 0x0F show the same slots as 0x00 --> 0x07
+ * and can be used in strings and in the frame buffer without the null character
+ */
+#define LCD_GLYPH_CODE(slot)           ((uint8)(0x08 + (slot)))
+/* Full 5x8 block of the character generator ROM */
+#define LCD_FULL_BLOCK                 0xFF
+
+/* CGRAM slots used by the progress bar segments of 1 --> 4 columns */
+#define LCD_PROGRESS_FIRST_SLOT        4
+#define LCD_PROGRESS_SEGMENTS          4
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+/* Custom characters defined in the flash glyph table */
+typedef enum {
+	LCD_GLYPH_LOCK, LCD_GLYPH_UNLOCK, LCD_GLYPH_LINK,
+	LCD_GLYPH_PROGRESS_1, LCD_GLYPH_PROGRESS_2, LCD_GLYPH_PROGRESS_3, LCD_GLYPH_PROGRESS_4,
+	LCD_NUM_GLYPHS
+}LCD_GlyphType;
 
 /*******************************************************************************
  *                      Functions Prototypes                                   *
@@ -87,6 +156,12 @@ void LCD_displayCharacter(uint8 data);
  */
 void LCD_displayString(const char *Str);
 
+/*
+ * Description :
+ * Display the required string stored in flash (PROGMEM) on the screen
+ */
+void LCD_displayString_P(const char *Str);
+
 /*
  * Description :
  * Move the cursor to a specified row and column index on the screen
@@ -99,6 +174,12 @@ void LCD_moveCursor(uint8 row,uint8 col);
  */
 void LCD_displayStringRowColumn(uint8 row,uint8 col,const char *Str);
 
+/*
+ * Description :
+ * Display the required string stored in flash (PROGMEM) in a specified row and column index on the screen
+ */
+void LCD_displayStringRowColumn_P(uint8 row,uint8 col,const char *Str);
+
 /*
  * Description :
  * Display the required decimal value on the screen
@@ -111,4 +192,99 @@ void LCD_intgerToString(int data);
  */
 void LCD_clearScreen(void);
 
+/*
+ * Description :
+ * Turn on the LCD backlight
+ */
+void LCD_backlightOn(void);
+
+/*******************************************************************************
+ *                    Shadow Frame Buffer Functions Prototypes                 *
+ *******************************************************************************/
+/*
+ * The application writes the screen content into an SRAM frame buffer with the LCD_FB functions,
+ * they never access the LCD. LCD_FB_refreshTask runs every system tick, it compares the
+ * frame buffer with a copy of what is on the glass and sends only the changed characters,
+ * a few bytes per tick. Do not use the direct LCD functions that write on the screen
+ * while the refresh task is running.
+ */
+
+/*
+ * Description :
+ * Fill the frame buffer with spaces and move its cursor to the first row and column
+ */
+void LCD_FB_clearScreen(void);
+
+/*
+ * Description :
+ * Move the frame buffer cursor to a specified row and column index
+ */
+void LCD_FB_moveCursor(uint8 row,uint8 col);
+
+/*
+ * Description :
+ * Write the required character in the frame buffer at the cursor position,
+ * characters after the end of the row are ignored
+ */
+void LCD_FB_displayCharacter(uint8 data);
+
+/*
+ * Description :
+ * Write the required string in the frame buffer at the cursor position
+ */
+void LCD_FB_displayString(const char *Str);
+
+/*
+ * Description :
+ * Write the required string stored in flash (PROGMEM) in the frame buffer at the cursor position
+ */
+void LCD_FB_displayString_P(const char *Str);
+
+/*
+ * Description :
+ * Write the required string in the frame buffer at a specified row and column index
+ */
+void LCD_FB_displayStringRowColumn(uint8 row,uint8 col,const char *Str);
+
+/*
+ * Description :
+ * Write the required string stored in flash (PROGMEM) in the frame buffer at a specified row and column index
+ */
+void LCD_FB_displayStringRowColumn_P(uint8 row,uint8 col,const char *Str);
+
+/*
+ * Description :
+ * Load the required glyph in a CGRAM slot and return the character code that shows it.
+ * The slot is uploaded by the refresh task only if it holds another glyph,
+ * the frame buffer cells that show the slot change on the glass without any DDRAM write.
+ */
+uint8 LCD_FB_setGlyph(uint8 slot,LCD_GlyphType glyph);
+
+/*
+ * Description :
+ * Draw a progress bar of width cells in the frame buffer at a specified row and column index,
+ * filled with value/max of its columns. Only the cells that change are sent to the LCD,
+ * one step of the bar is usually one DDRAM write.
+ */
+void LCD_FB_displayProgressBar(uint8 row,uint8 col,uint8 width,uint16 value,uint16 max);
+
+/*
+ * Description :
+ * Send the next frame buffer changes to the screen, at most LCD_REFRESH_BYTES_PER_TICK bytes.
+ * Return TRUE if there are still changes to send.
+ */
+boolean LCD_FB_refreshTask(void);
+
+/*
+ * Description :
+ * Send all the frame buffer changes to the screen and return when the glass is up to date
+ */
+void LCD_FB_flush(void);
+
+/*
+ * Description :
+ * Turn off the LCD backlight
+ */
+void LCD_backlightOff(void);
+
 #endif /* LCD_H_ */
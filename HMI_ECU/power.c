@@ -0,0 +1,178 @@
+/******************************************************************************
+ *
+ * Module: Power Management
+ *
+ * File Name: power.c
+ *
+ * Description: Source file for the HMI ECU power-down mode with keypad wake up
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+#include "power.h"
+#include <avr/io.h> /* To use the External Interrupt and Timer1 Registers */
+#include <avr/interrupt.h> /* For INT2 ISR */
+#include <avr/sleep.h> /* For the sleep instruction */
+#include "common_macros.h"
+#include "gpio.h"
+#include "keypad.h"
+#include "lcd.h"
+#include "pt.h"
+
+/*******************************************************************************
+ *                           Global Variables                                  *
+ *******************************************************************************/
+/* Time stamp taken by the INT2 ISR, in Timer1 counts */
+static volatile uint32 g_wakeupTimestamp = 0;
+/* Set by the INT2 ISR when the keypad woke the CPU */
+static volatile boolean g_wakeupFlag = FALSE;
+/* The wake up latency is measured until the first debounced key event */
+static boolean g_latencyRunning = FALSE;
+/* Wake up latency measurements */
+static Power_WakeupLatencyType g_wakeupLatency = { 0, 0, 0 };
+
+/*******************************************************************************
+ *                      Functions Definitions (Private)                        *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Private function to read the time in Timer1 counts, called with interrupts disabled.
+ * If the compare match flag is still pending the tick ISR did not count it yet, so count it here.
+ */
+static uint32 Power_getTimestamp(void)
+{
+	uint16 count = TCNT1;
+	uint32 timestamp = (uint32)PT_getTick() * POWER_TIMER_COUNTS_PER_TICK;
+
+	if(BIT_IS_SET(TIFR,OCF1A) && (count < (POWER_TIMER_COUNTS_PER_TICK / 2)))
+	{
+		timestamp += POWER_TIMER_COUNTS_PER_TICK;
+	}
+	return timestamp + count;
+}
+
+/*******************************************************************************
+ *                       Interrupt Service Routines                            *
+ *******************************************************************************/
+
+/* External Interrupt 2 ISR, a keypad button is pressed */
+ISR(INT2_vect)
+{
+	/* One shot: disable INT2 until the next power-down */
+	CLEAR_BIT(GICR,INT2);
+	g_wakeupTimestamp = Power_getTimestamp();
+	g_wakeupFlag = TRUE;
+}
+
+/*******************************************************************************
+ *                      Functions Definitions                                  *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Put the HMI ECU in power-down mode until a key is pressed:
+ * 1. Turn off the LCD backlight and drive all the keypad rows low.
+ * 2. Enable INT2 on the falling edge and enter power-down.
+ * 3. After the wake up, do the first keypad scan and turn on the backlight, the latency is measured
+ *    until the debounce puts the key into the typeahead buffer (Power_keypadTask).
+ */
+void Power_enterPowerDown(void)
+{
+	LCD_backlightOff();
+	KEYPAD_prepareWakeup();
+
+	/* Wake up pin is input with internal pull-up resistor */
+	GPIO_setupPinDirectionInline(POWER_WAKEUP_PORT_ID,POWER_WAKEUP_PIN_ID,PIN_INPUT);
+	GPIO_writePinInline(POWER_WAKEUP_PORT_ID,POWER_WAKEUP_PIN_ID,LOGIC_HIGH);
+
+	/*
+	 * INT2 on the falling edge ISC2=0, INT2 must be disabled while changing ISC2
+	 * and its flag cleared after that to avoid a false interrupt
+	 */
+	CLEAR_BIT(GICR,INT2);
+	CLEAR_BIT(MCUCSR,ISC2);
+	GIFR = (1<<INTF2);
+	g_wakeupFlag = FALSE;
+	SET_BIT(GICR,INT2);
+
+	set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+
+	/*
+	 * Do not sleep if a key is already pressed, nothing would wake the CPU up,
+	 * or if a key event is still in the typeahead buffer
+	 */
+	cli();
+	if((GPIO_readPinInline(POWER_WAKEUP_PORT_ID,POWER_WAKEUP_PIN_ID) == LOGIC_HIGH) && !KEYPAD_isEventPending())
+	{
+		sleep_enable();
+		sei(); /* The sleep instruction is executed before any pending interrupt */
+		sleep_cpu();
+		sleep_disable();
+	}
+	sei();
+
+	CLEAR_BIT(GICR,INT2);
+	KEYPAD_releaseWakeup();
+
+	/* First scan after the wake up starts the debounce, the system tick callback runs the next ones */
+	g_latencyRunning = g_wakeupFlag;
+	KEYPAD_scanTask();
+	Power_keypadTask();
+
+	LCD_backlightOn();
+}
+
+/*
+ * Description :
+ * Called after every keypad scan: stop the wake up latency when the first debounced key event
+ * is in the typeahead buffer, nothing takes it out between the scan and this task.
+ * A wake up without a debounced key for 65 msec (the 16-bit range) is a contact bounce
+ * or noise on the wake up pin, it is not a latency and it is not counted.
+ */
+void Power_keypadTask(void)
+{
+	uint32 latency;
+
+	if(!g_latencyRunning)
+	{
+		return;
+	}
+	cli();
+	latency = (Power_getTimestamp() - g_wakeupTimestamp) * POWER_TIMER_COUNT_US;
+	sei();
+
+	if(!KEYPAD_isEventPending())
+	{
+		if(latency > 0xFFFF)
+		{
+			g_latencyRunning = FALSE;
+		}
+		return;
+	}
+	g_latencyRunning = FALSE;
+
+	/* Saturate to the 16-bit measurement range */
+	if(latency > 0xFFFF)
+	{
+		latency = 0xFFFF;
+	}
+	g_wakeupLatency.last_us = (uint16)latency;
+	if(g_wakeupLatency.last_us > g_wakeupLatency.max_us)
+	{
+		g_wakeupLatency.max_us = g_wakeupLatency.last_us;
+	}
+	if((latency > POWER_WAKEUP_LATENCY_BUDGET_US) && (g_wakeupLatency.budget_misses != 0xFF))
+	{
+		g_wakeupLatency.budget_misses++;
+	}
+}
+
+/*
+ * Description :
+ * Get the wake up to first debounced key latency measurements.
+ */
+void Power_getWakeupLatency(Power_WakeupLatencyType *latency)
+{
+	*latency = g_wakeupLatency;
+}
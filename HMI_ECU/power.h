@@ -0,0 +1,80 @@
+/******************************************************************************
+ *
+ * Module: Power Management
+ *
+ * File Name: power.h
+ *
+ * Description: Header file for the HMI ECU power-down mode with keypad wake up
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+
+#ifndef POWER_H_
+#define POWER_H_
+
+#include "std_types.h"
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+/*
+ * Wake up pin: the keypad column lines are wired-OR (through diodes) into INT2,
+ * so any pressed key pulls INT2 low while all the keypad rows are driven low.
+ * INT2 is asynchronous, it is the only external interrupt that detects an edge in power-down.
+ */
+#define POWER_WAKEUP_PORT_ID            PORTB_ID
+#define POWER_WAKEUP_PIN_ID             PIN2_ID
+
+/*
+ * Wake up latency time base: Timer1 system tick with F_CPU/64
+ * One Timer1 count = 8usec and one system tick = 125 counts = 1 msec
+ */
+#define POWER_TIMER_COUNT_US            8
+#define POWER_TIMER_COUNTS_PER_TICK     125
+
+/*
+ * Maximum accepted time from the wake up interrupt to the first debounced key event in the
+ * typeahead buffer: the first scan runs at the wake up, the key is debounced after
+ * KEYPAD_DEBOUNCE_SCANS scans KEYPAD_SCAN_PERIOD_MS apart (8 msec) plus the contact bounce.
+ * The oscillator start-up time comes before the interrupt and is set by the SUT/CKSEL fuses,
+ * keep it short (e.g. internal RC with SUT = 00: 6 CK) so the total stays under 10 msec.
+ */
+#define POWER_WAKEUP_LATENCY_BUDGET_US  10000
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+typedef struct {
+	uint16 last_us;         /* Latency of the last wake up, to the first debounced key event */
+	uint16 max_us;          /* Worst latency since reset */
+	uint8 budget_misses;    /* Number of wake ups above POWER_WAKEUP_LATENCY_BUDGET_US */
+}Power_WakeupLatencyType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Put the HMI ECU in power-down mode until a key is pressed:
+ * 1. Turn off the LCD backlight and drive all the keypad rows low.
+ * 2. Enable INT2 on the falling edge and enter power-down.
+ * 3. After the wake up, do the first keypad scan and turn on the backlight.
+ */
+void Power_enterPowerDown(void);
+
+/*
+ * Description :
+ * Called after every KEYPAD_scanTask, it stops the wake up latency measurement
+ * when the first debounced key event is in the typeahead buffer.
+ */
+void Power_keypadTask(void);
+
+/*
+ * Description :
+ * Get the wake up to first debounced key latency measurements.
+ */
+void Power_getWakeupLatency(Power_WakeupLatencyType *latency);
+
+#endif /* POWER_H_ */
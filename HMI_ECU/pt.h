@@ -0,0 +1,123 @@
+ /******************************************************************************
+ *
+ * Module: Protothreads
+ *
+ * File Name: pt.h
+ *
+ * Description: Stackless coroutines (protothreads) for the HMI user flows
+ *
+ * Author: Kareem Abd El-Moneam
+ *
+ *******************************************************************************/
+
+#ifndef PT_H_
+#define PT_H_
+
+#include "std_types.h"
+
+/*
+ * How it works:
+ * A coroutine is a normal function whose body is wrapped in one switch statement.
+ * Every wait point saves its own source line in the thread structure and returns,
+ * the next call jumps straight back to that line through the switch.
+ * So the RAM cost of a coroutine is only its PT_ThreadType (4 bytes), not a stack.
+ *
+ * Rules inside a coroutine body:
+ * 1. Local variables are NOT kept across a wait point, use static or global variables.
+ * 2. Do not use a switch statement that contains a wait point, use if/else instead.
+ * 3. Only one wait point per source line.
+ */
+
+/*******************************************************************************
+ *                                Definitions                                  *
+ *******************************************************************************/
+/* Coroutine return values */
+#define PT_WAITING                 0    /* Blocked on a wait condition */
+#define PT_YIELDED                 1    /* Gave the CPU back voluntarily */
+#define PT_EXITED                  2    /* Left through PT_EXIT */
+#define PT_ENDED                   3    /* Reached PT_END */
+
+/*******************************************************************************
+ *                         Types Declaration                                   *
+ *******************************************************************************/
+typedef struct {
+	uint16 lc;          /* Local continuation: source line of the last wait point */
+	uint16 timestamp;   /* Tick captured at the start of the last timeout wait */
+}PT_ThreadType;
+
+/*******************************************************************************
+ *                      Functions Prototypes                                   *
+ *******************************************************************************/
+
+/*
+ * Description :
+ * Return the free running system tick (1 tick = 1 ms) used by the timeout macros.
+ * It is implemented by the application that owns the tick timer.
+ */
+uint16 PT_getTick(void);
+
+/*
+ * Description :
+ * Take the next byte received from the other ECU, return FALSE if there is none.
+ * It is implemented by the application that owns the UART.
+ */
+boolean PT_takeFrame(uint8 *frame);
+
+/*******************************************************************************
+ *                            Coroutine Macros                                 *
+ *******************************************************************************/
+
+/* Declare a coroutine, e.g. static PT_THREAD(flow(PT_ThreadType *pt)) */
+#define PT_THREAD(name_args)                    uint8 name_args
+
+/* Restart the coroutine from its first line on the next call */
+#define PT_INIT(pt)                             ((pt)->lc = 0)
+
+/* Open and close the coroutine body */
+#define PT_BEGIN(pt)                            switch((pt)->lc) { case 0:
+#define PT_END(pt)                              } PT_INIT(pt); return PT_ENDED
+
+/* Block while the condition is false */
+#define PT_WAIT_UNTIL(pt, condition)            \
+	do { (pt)->lc = __LINE__; case __LINE__: if(!(condition)) return PT_WAITING; } while(0)
+
+/* Block while the condition is true */
+#define PT_WAIT_WHILE(pt, condition)            PT_WAIT_UNTIL((pt), !(condition))
+
+/* Give the CPU back once, then keep yielding until the condition is true */
+#define PT_YIELD_UNTIL(pt, condition)           \
+	do { (pt)->lc = __LINE__; return PT_YIELDED; case __LINE__: if(!(condition)) return PT_YIELDED; } while(0)
+
+/* Give the CPU back once */
+#define PT_YIELD(pt)                            PT_YIELD_UNTIL((pt), TRUE)
+
+/* TRUE when the given number of ticks passed since the last timeout wait started */
+#define PT_TIMEOUT_EXPIRED(pt, ticks)           ((uint16)(PT_getTick() - (pt)->timestamp) >= (uint16)(ticks))
+
+/* Block for the given number of ticks (max 65535 ms) */
+#define PT_WAIT_TIMEOUT(pt, ticks)              \
+	do { (pt)->timestamp = PT_getTick(); PT_WAIT_UNTIL((pt), PT_TIMEOUT_EXPIRED((pt), (ticks))); } while(0)
+
+/* Block until the condition is true or the given number of ticks passed */
+#define PT_WAIT_UNTIL_OR_TIMEOUT(pt, condition, ticks)    \
+	do { (pt)->timestamp = PT_getTick(); \
+		PT_WAIT_UNTIL((pt), (condition) || PT_TIMEOUT_EXPIRED((pt), (ticks))); } while(0)
+
+/* Block until a byte is received from the other ECU, then store it in frame */
+#define PT_WAIT_UART_FRAME(pt, frame)           PT_WAIT_UNTIL((pt), PT_takeFrame(&(frame)))
+
+/* Block until a child coroutine call returns PT_EXITED or PT_ENDED */
+#define PT_WAIT_THREAD(pt, thread_call)         PT_WAIT_WHILE((pt), (thread_call) < PT_EXITED)
+
+/* Start a child coroutine from its first line and block until it finishes */
+#define PT_SPAWN(pt, child, thread_call)        \
+	do { PT_INIT(child); PT_WAIT_THREAD((pt), (thread_call)); } while(0)
+
+/* Restart or leave the coroutine from inside its body */
+#define PT_RESTART(pt)                          do { PT_INIT(pt); return PT_WAITING; } while(0)
+#define PT_EXIT(pt)                             do { PT_INIT(pt); return PT_EXITED; } while(0)
+
+/* Run a coroutine one step, evaluates to TRUE while it is still running */
+#define PT_SCHEDULE(thread_call)                ((thread_call) < PT_EXITED)
+
+#endif /* PT_H_ */
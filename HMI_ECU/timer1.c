@@ -12,6 +12,7 @@
 #include "timer1.h"
 #include <avr/io.h> /* To use Timer1 Registers */
 #include <avr/interrupt.h> /* For Timer1 ISR */
+#include <util/atomic.h> /* To read the tick counter updated by the ISR */
 #include "std_types.h"
 
 /*******************************************************************************
@@ -19,29 +20,37 @@
  *******************************************************************************/
 
 /* Global variables to hold the address of the call back function in the application */
-static volatile void (*g_callBackPtr)(void) = NULL_PTR;
+static void (*volatile g_callBackPtr)(void) = NULL_PTR;
+
+/* Ticks (compare matches or overflows) counted by the ISR, and the ones the call back did not run yet */
+static volatile uint16 g_ticks = 0;
+static volatile uint8 g_pendingTicks = 0;
 
 /*******************************************************************************
  *                       Interrupt Service Routines                            *
  *******************************************************************************/
 
-/* Timer1 CTC Mode ISR */
+/*
+ * Timer1 CTC Mode ISR, count the tick inline: the call back is run later for every pending tick
+ * by Timer1_runPendingTicks in the main context. Without a function call avr-gcc only saves
+ * the registers the counters need instead of all the call-clobbered registers.
+ */
 ISR(TIMER1_COMPA_vect)
 {
-	if(g_callBackPtr != NULL_PTR)
+	g_ticks++;
+	if(g_pendingTicks != 0xFF)
 	{
-		/* Call the Call Back function in the application after the edge is detected */
-		(*g_callBackPtr)(); /* another method to call the function using pointer to function g_callBackPtr(); */
+		g_pendingTicks++;
 	}
 }
 
-/* Timer1 Normal Mode ISR */
+/* Timer1 Normal Mode ISR, the same inline tick count */
 ISR(TIMER1_OVF_vect)
 {
-	if(g_callBackPtr != NULL_PTR)
+	g_ticks++;
+	if(g_pendingTicks != 0xFF)
 	{
-		/* Call the Call Back function in the application after the edge is detected */
-		(*g_callBackPtr)(); /* another method to call the function using pointer to function g_callBackPtr(); */
+		g_pendingTicks++;
 	}
 }
 
@@ -59,6 +68,8 @@ void Timer1_init(const Timer1_ConfigType * Config_Ptr)
 {
 	/* Initial Value for Timer1 */
 	TCNT1 = Config_Ptr->initial_value;
+	g_ticks = 0;
+	g_pendingTicks = 0;
 
 	/* Set the required mode */
 	/* Non-PWM Mode */
@@ -110,3 +121,48 @@ void Timer1_setCallBack(void(*a_ptr)(void))
 	/* Save the address of the Call back function in a global variable */
 	g_callBackPtr = a_ptr;
 }
+
+/*
+ * Description :
+ * Function to return the number of ticks counted by the ISR, it wraps after 65536 ticks
+ */
+uint16 Timer1_getTicks(void)
+{
+	uint16 ticks;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ticks = g_ticks;
+	}
+	return ticks;
+}
+
+/*
+ * Description :
+ * Function to run the call back once for every tick counted since the last call:
+ * - No pending tick: return FALSE at once, the global interrupts are not changed.
+ * - Else take the pending ticks with the interrupts disabled, then enable them, run the call back
+ *   and return TRUE. The ISR saturates at 255 pending ticks, older ones are lost.
+ */
+boolean Timer1_runPendingTicks(void)
+{
+	uint8 ticks = g_pendingTicks;
+
+	if(ticks == 0)
+	{
+		return FALSE;
+	}
+	cli();
+	ticks = g_pendingTicks;
+	g_pendingTicks = 0;
+	sei();
+	if(g_callBackPtr != NULL_PTR)
+	{
+		while(ticks != 0)
+		{
+			(*g_callBackPtr)();
+			ticks--;
+		}
+	}
+	return TRUE;
+}
@@ -52,9 +52,25 @@ void Timer1_deInit(void);
 
 /*
  * Description :
- * Function to set the call back function address
+ * Function to set the call back function address, it is not called from the ISR:
+ * the ISR only counts the ticks and Timer1_runPendingTicks calls it once for every tick
  */
 void Timer1_setCallBack(void(*a_ptr)(void));
 
+/*
+ * Description :
+ * Function to return the number of ticks (compare matches or overflows) counted by the ISR,
+ * it wraps after 65536 ticks
+ */
+uint16 Timer1_getTicks(void);
+
+/*
+ * Description :
+ * Function to run the call back once for every tick counted since the last call, from the main
+ * context. It returns FALSE without changing the global interrupts if no tick is pending,
+ * else it returns TRUE with the interrupts enabled.
+ */
+boolean Timer1_runPendingTicks(void);
+
 
 #endif /* TIMER1_H_ */
@@ -104,6 +104,16 @@ uint8 UART_receiveByte(void)
     return UDR;
 }
 
+/*
+ * Description :
+ * Return TRUE if a received byte is waiting in the Rx buffer,
+ * so the caller can read it with UART_receiveByte without blocking.
+ */
+boolean UART_isByteReceived(void)
+{
+	return BIT_IS_SET(UCSRA, RXC) ? TRUE : FALSE;
+}
+
 /*
  * Description :
  * Send the required string through UART to the other UART device.
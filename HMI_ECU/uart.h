@@ -17,6 +17,11 @@
 
 #define MC1_READY   	   0x10
 #define MC2_READY   	   0x20
+/* Door events sent by the Control ECU when a door reaches its position, plus the door number (0 -->) */
+#define DOOR_UNLOCKED      0x30
+#define DOOR_LOCKED        0x40
+/* Door move failed (worst case timeout or abandoned after stalls), plus the door number (0 -->) */
+#define DOOR_FAULT         0x50
 
 #define F_CPU 8000000UL
 
@@ -89,6 +94,13 @@ void UART_sendByte(const uint8 data);
  */
 uint8 UART_receiveByte(void);
 
+/*
+ * Description :
+ * Return TRUE if a received byte is waiting in the Rx buffer,
+ * so the caller can read it with UART_receiveByte without blocking.
+ */
+boolean UART_isByteReceived(void);
+
 /*
  * Description :
  * Send the required string through UART to the other UART device.